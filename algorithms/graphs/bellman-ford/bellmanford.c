@@ -9,11 +9,19 @@
  *  INT_MAX defined in limits.h is used to denote
  *  infinity.
  *
+ *  bellmanFordCsr() runs on a compressed sparse row
+ *  graph instead, so each round relaxes the E edges
+ *  rather than scanning V^2 matrix entries, and it
+ *  stops as soon as a round changes nothing.
+ *
  */
 
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <math.h>
 
@@ -80,6 +88,66 @@ typedef struct DistPath
 } DistPath;
 
 
+/* Compressed sparse row (CSR) graph */
+
+// vertex ids are 32-bit, or 64-bit when compiled with -DCSR_64BIT_IDS
+#ifdef CSR_64BIT_IDS
+typedef uint64_t vertex_t;
+#define PRIvtx PRIu64
+#else
+typedef uint32_t vertex_t;
+#define PRIvtx PRIu32
+#endif
+
+// no vertex, e.g. the parent of the source
+#define NO_VERTEX ((vertex_t)-1)
+
+typedef struct CsrGraph
+{
+    size_t    V;         // |V|
+    size_t    E;         // no. of directed edges
+    size_t*   offsets;   // V + 1 entries, the edges of u are
+                         // [offsets[u], offsets[u + 1])
+    vertex_t* neighbors; // E entries, the head of each edge
+    int*      weights;   // E entries, or NULL if unweighted
+} CsrGraph;
+
+/* An edge of an edge list */
+typedef struct Edge
+{
+    vertex_t u; // tail
+    vertex_t v; // head
+    int      w; // weight, ignored for unweighted graphs
+} Edge;
+
+/* CSR graph helpers */
+
+// build a graph of V vertices from E edges in O(V + E); the edges of
+// each vertex keep their order in the list
+//  => weighted  - keep the weights of the edges
+//  => symmetric - also add (v, u) for every edge (u, v), for
+//                 undirected graphs
+// returns NULL on memory error or on an invalid vertex
+CsrGraph* csrFromEdges(size_t V, const Edge* edges, size_t E, int weighted, int symmetric);
+
+// destroy graph
+void destroyCsrGraph(CsrGraph* g);
+
+// print the edges of every vertex
+void displayCsrGraph(CsrGraph* g);
+
+
+/* Distance & shortest path tree of a CSR graph */
+
+typedef struct CsrDistPath
+{
+    long long* distance;      // distance from source, LLONG_MAX if unreachable
+    vertex_t*  previous;      // parent in the shortest path tree, NO_VERTEX
+                              // for the source & unreachable vertices
+    int        negativeCycle; // set if a negative cycle is reachable
+} CsrDistPath;
+
+
 /* Bellman-Ford algorithm */
 
 // Find the shortest paths from source to all other target vertices
@@ -89,14 +157,33 @@ DistPath* bellmanFord(WtGraph* wg, unsigned src);
 // `target` by using a shortest path table
 List* reconstructPath(unsigned* previous, unsigned target);
 
+// Find the shortest paths from source on a CSR graph,
+// in O(VE) time and O(V) memory besides the graph; the
+// edges of an unweighted graph all weigh 1
+// returns NULL on memory error or an invalid source
+CsrDistPath* bellmanFordCsr(CsrGraph* g, vertex_t src);
+
+// Destroy the result of bellmanFordCsr()
+void destroyCsrDistPath(CsrDistPath* dp);
+
+// Write the path from source to `target` into `path`,
+// which must have room for V vertices, and return its
+// length; only valid without a negative cycle
+size_t reconstructCsrPath(const vertex_t* previous, vertex_t target, vertex_t* path);
+
 
 // test 1 : test the implementation
 // of Bellman-Ford algorithm
 void test1();
 
+// test 2 : Bellman-Ford on the
+// test 1 graph, stored as CSR
+void test2();
+
 int main()
 {
     test1();
+    test2();
     return EXIT_SUCCESS;
 }
 
@@ -330,6 +417,199 @@ List* reconstructPath(unsigned* previous, unsigned target)
     return path;
 }
 
+CsrGraph* csrFromEdges(size_t V, const Edge* edges, size_t E, int weighted, int symmetric)
+{
+    size_t M = symmetric ? 2 * E : E, i;
+    CsrGraph* g = (CsrGraph* )malloc(sizeof(CsrGraph));
+    size_t* next = (size_t* )malloc((V + 1) * sizeof(size_t));
+
+    if (g)
+    {
+        g->V = V;
+        g->E = M;
+        g->offsets = (size_t* )calloc(V + 1, sizeof(size_t));
+        g->neighbors = (vertex_t* )malloc((M ? M : 1) * sizeof(vertex_t));
+        g->weights = weighted ? (int* )malloc((M ? M : 1) * sizeof(int)) : NULL;
+    }
+
+    if (!g || !next || !g->offsets || !g->neighbors || (weighted && !g->weights))
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(next);
+        if (g)
+            destroyCsrGraph(g);
+        return NULL;
+    }
+
+    // Step 1 : count the edges of every vertex, one slot ahead
+    for (i = 0; i < E; ++i)
+    {
+        if (edges[i].u >= V || edges[i].v >= V)
+        {
+            fprintf(stderr, "[ERROR] Invalid edge %" PRIvtx " -> %" PRIvtx "\n",
+                    edges[i].u, edges[i].v);
+            free(next);
+            destroyCsrGraph(g);
+            return NULL;
+        }
+
+        g->offsets[edges[i].u + 1]++;
+        if (symmetric)
+            g->offsets[edges[i].v + 1]++;
+    }
+
+    // Step 2 : prefix sums turn the counts into offsets
+    for (i = 0; i < V; ++i)
+        g->offsets[i + 1] += g->offsets[i];
+
+    // Step 3 : drop every edge in the next free slot of its tail
+    memcpy(next, g->offsets, (V + 1) * sizeof(size_t));
+    for (i = 0; i < E; ++i)
+    {
+        size_t at = next[edges[i].u]++;
+        g->neighbors[at] = edges[i].v;
+        if (weighted)
+            g->weights[at] = edges[i].w;
+
+        if (symmetric)
+        {
+            at = next[edges[i].v]++;
+            g->neighbors[at] = edges[i].u;
+            if (weighted)
+                g->weights[at] = edges[i].w;
+        }
+    }
+
+    free(next);
+    return g;
+}
+
+void destroyCsrGraph(CsrGraph* g)
+{
+    free(g->offsets);
+    free(g->neighbors);
+    free(g->weights);
+    free(g);
+}
+
+void displayCsrGraph(CsrGraph* g)
+{
+    for (size_t u = 0; u < g->V; ++u)
+    {
+        printf("%zu :", u);
+        for (size_t e = g->offsets[u]; e < g->offsets[u + 1]; ++e)
+        {
+            if (g->weights)
+                printf(" %" PRIvtx "(%d)", g->neighbors[e], g->weights[e]);
+            else
+                printf(" %" PRIvtx, g->neighbors[e]);
+        }
+        printf("\n");
+    }
+}
+
+CsrDistPath* bellmanFordCsr(CsrGraph* g, vertex_t src)
+{
+    if (src >= g->V)
+    {
+        fprintf(stderr, "[ERROR] Invalid source vertex %" PRIvtx "\n", src);
+        return NULL;
+    }
+
+    CsrDistPath* dp = (CsrDistPath* )malloc(sizeof(CsrDistPath));
+    if (!dp)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return NULL;
+    }
+    dp->distance = (long long* )malloc((g->V ? g->V : 1) * sizeof(long long));
+    dp->previous = (vertex_t* )malloc((g->V ? g->V : 1) * sizeof(vertex_t));
+    dp->negativeCycle = 0;
+    if (!dp->distance || !dp->previous)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        destroyCsrDistPath(dp);
+        return NULL;
+    }
+
+    size_t i, u, e;
+
+    // Step 1 : Initialize distance to all other vertices as INFINITY
+    for (u = 0; u < g->V; ++u)
+    {
+        dp->distance[u] = LLONG_MAX;
+        dp->previous[u] = NO_VERTEX;
+    }
+    dp->distance[src] = 0;
+
+    // Step 2 : Relax all E edges up to |V| - 1 times. Distances
+    // are long long, so a path of int weights can't overflow, and
+    // once a round changes nothing, no later round will either.
+    int changed = 1;
+    for (i = 0; changed && i + 1 < g->V; ++i)
+    {
+        changed = 0;
+        for (u = 0; u < g->V; ++u)
+        {
+            if (dp->distance[u] == LLONG_MAX)
+                continue;
+
+            for (e = g->offsets[u]; e < g->offsets[u + 1]; ++e)
+            {
+                long long d = dp->distance[u] + (g->weights ? g->weights[e] : 1);
+                if (d < dp->distance[g->neighbors[e]])
+                {
+                    dp->distance[g->neighbors[e]] = d;
+                    dp->previous[g->neighbors[e]] = (vertex_t)u;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    // Step 3 : Check for negative-weight cycles, needed only
+    // if the last round still changed something
+    for (u = 0; changed && u < g->V && !dp->negativeCycle; ++u)
+    {
+        if (dp->distance[u] == LLONG_MAX)
+            continue;
+
+        for (e = g->offsets[u]; e < g->offsets[u + 1]; ++e)
+            if (dp->distance[u] + (g->weights ? g->weights[e] : 1) <
+                dp->distance[g->neighbors[e]])
+            {
+                fprintf(stderr, "[ERROR] Graph contains negative weight cycle\n");
+                dp->negativeCycle = 1;
+                break;
+            }
+    }
+
+    return dp;
+}
+
+void destroyCsrDistPath(CsrDistPath* dp)
+{
+    free(dp->distance);
+    free(dp->previous);
+    free(dp);
+}
+
+size_t reconstructCsrPath(const vertex_t* previous, vertex_t target, vertex_t* path)
+{
+    // walk up the tree once for the length, then
+    // again to fill the path from its end
+    size_t len = 1, i;
+    vertex_t u;
+
+    for (u = target; previous[u] != NO_VERTEX; u = previous[u])
+        ++len;
+
+    for (u = target, i = len; i > 0; u = previous[u])
+        path[--i] = u;
+
+    return len;
+}
+
 void test1()
 {
     // test graph of size 5, having
@@ -405,3 +685,58 @@ void test1()
 
     destroyGraph(wg);
 }
+
+void test2()
+{
+    // the test 1 graph, as a list of
+    // directed weighted edges
+    Edge edges[] = {
+        { 0, 1, -1 }, { 0, 2, 4 },
+        { 1, 2, 3 }, { 1, 3, 1 }, { 1, 4, 2 },
+        { 3, 1, 1 }, { 3, 2, 5 },
+        { 4, 3, -3 }
+    };
+    size_t V = 5, E = sizeof(edges) / sizeof(edges[0]), i, j;
+
+    CsrGraph* g = csrFromEdges(V, edges, E, 1, 0);
+    if (!g)
+        return;
+
+    printf("\nTest graph (CSR) :-\n");
+    displayCsrGraph(g);
+
+    CsrDistPath* dp = bellmanFordCsr(g, 0);
+    vertex_t* path = (vertex_t* )malloc(V * sizeof(vertex_t));
+    if (!dp || !path)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(path);
+        if (dp)
+            destroyCsrDistPath(dp);
+        destroyCsrGraph(g);
+        return;
+    }
+
+    printf("\nDistances & paths :-\n");
+    for (i = 0; i < V; ++i)
+    {
+        if (dp->distance[i] == LLONG_MAX)
+        {
+            printf("Target : %zu,\tunreachable\n", i);
+            continue;
+        }
+
+        printf("Target : %zu,\tDistance : %lld\t,Path : ", i, dp->distance[i]);
+        if (!dp->negativeCycle)
+        {
+            size_t len = reconstructCsrPath(dp->previous, (vertex_t)i, path);
+            for (j = 0; j < len; ++j)
+                printf("%" PRIvtx " ", path[j]);
+        }
+        printf("\n");
+    }
+
+    free(path);
+    destroyCsrDistPath(dp);
+    destroyCsrGraph(g);
+}
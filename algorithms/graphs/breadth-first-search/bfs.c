@@ -1,6 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h> // for sysconf()
 
 /* Linked list structure */
 
@@ -135,6 +141,139 @@ void displayGraph(Graph* g)
     }
 }
 
+/* Compressed sparse row (CSR) graph */
+
+// vertex ids are 32-bit, or 64-bit when compiled with -DCSR_64BIT_IDS
+#ifdef CSR_64BIT_IDS
+typedef uint64_t vertex_t;
+#define PRIvtx PRIu64
+#else
+typedef uint32_t vertex_t;
+#define PRIvtx PRIu32
+#endif
+
+// no vertex, e.g. the parent of the source
+#define NO_VERTEX ((vertex_t)-1)
+
+typedef struct CsrGraph
+{
+    size_t    V;         // |V|
+    size_t    E;         // no. of directed edges
+    size_t*   offsets;   // V + 1 entries, the edges of u are
+                         // [offsets[u], offsets[u + 1])
+    vertex_t* neighbors; // E entries, the head of each edge
+    int*      weights;   // E entries, or NULL if unweighted
+} CsrGraph;
+
+/* An edge of an edge list */
+typedef struct Edge
+{
+    vertex_t u; // tail
+    vertex_t v; // head
+    int      w; // weight, ignored for unweighted graphs
+} Edge;
+
+/* CSR graph helpers */
+
+// destroy graph
+void destroyCsrGraph(CsrGraph* g)
+{
+    free(g->offsets);
+    free(g->neighbors);
+    free(g->weights);
+    free(g);
+}
+
+// build a graph of V vertices from E edges in O(V + E); the edges of
+// each vertex keep their order in the list
+//  => weighted  - keep the weights of the edges
+//  => symmetric - also add (v, u) for every edge (u, v), for
+//                 undirected graphs
+// returns NULL on memory error or on an invalid vertex
+CsrGraph* csrFromEdges(size_t V, const Edge* edges, size_t E, int weighted, int symmetric)
+{
+    size_t M = symmetric ? 2 * E : E, i;
+    CsrGraph* g = (CsrGraph* )malloc(sizeof(CsrGraph));
+    size_t* next = (size_t* )malloc((V + 1) * sizeof(size_t));
+
+    if (g)
+    {
+        g->V = V;
+        g->E = M;
+        g->offsets = (size_t* )calloc(V + 1, sizeof(size_t));
+        g->neighbors = (vertex_t* )malloc((M ? M : 1) * sizeof(vertex_t));
+        g->weights = weighted ? (int* )malloc((M ? M : 1) * sizeof(int)) : NULL;
+    }
+
+    if (!g || !next || !g->offsets || !g->neighbors || (weighted && !g->weights))
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(next);
+        if (g)
+            destroyCsrGraph(g);
+        return NULL;
+    }
+
+    // Step 1 : count the edges of every vertex, one slot ahead
+    for (i = 0; i < E; ++i)
+    {
+        if (edges[i].u >= V || edges[i].v >= V)
+        {
+            fprintf(stderr, "[ERROR] Invalid edge %" PRIvtx " -> %" PRIvtx "\n",
+                    edges[i].u, edges[i].v);
+            free(next);
+            destroyCsrGraph(g);
+            return NULL;
+        }
+
+        g->offsets[edges[i].u + 1]++;
+        if (symmetric)
+            g->offsets[edges[i].v + 1]++;
+    }
+
+    // Step 2 : prefix sums turn the counts into offsets
+    for (i = 0; i < V; ++i)
+        g->offsets[i + 1] += g->offsets[i];
+
+    // Step 3 : drop every edge in the next free slot of its tail
+    memcpy(next, g->offsets, (V + 1) * sizeof(size_t));
+    for (i = 0; i < E; ++i)
+    {
+        size_t at = next[edges[i].u]++;
+        g->neighbors[at] = edges[i].v;
+        if (weighted)
+            g->weights[at] = edges[i].w;
+
+        if (symmetric)
+        {
+            at = next[edges[i].v]++;
+            g->neighbors[at] = edges[i].u;
+            if (weighted)
+                g->weights[at] = edges[i].w;
+        }
+    }
+
+    free(next);
+    return g;
+}
+
+// print the edges of every vertex
+void displayCsrGraph(CsrGraph* g)
+{
+    for (size_t u = 0; u < g->V; ++u)
+    {
+        printf("%zu :", u);
+        for (size_t e = g->offsets[u]; e < g->offsets[u + 1]; ++e)
+        {
+            if (g->weights)
+                printf(" %" PRIvtx "(%d)", g->neighbors[e], g->weights[e]);
+            else
+                printf(" %" PRIvtx, g->neighbors[e]);
+        }
+        printf("\n");
+    }
+}
+
 /* Breadth First Search algorithm implementation */
 void BFS(Graph* g, size_t src)
 {
@@ -171,6 +310,529 @@ void BFS(Graph* g, size_t src)
     destroyQueue(vertexQ);
 }
 
+/* Breadth First Search on a CSR graph, in O(V + E) */
+void BFSCsr(CsrGraph* g, vertex_t src)
+{
+    if (src >= g->V)
+    {
+        fprintf(stderr, "[ERROR] Invalid source vertex %" PRIvtx "\n", src);
+        return;
+    }
+
+    // every vertex is enqueued at most once, so a flat array
+    // of V entries is enough for the queue
+    vertex_t* queue = (vertex_t* )malloc(g->V * sizeof(vertex_t));
+    unsigned char* visited = (unsigned char* )calloc(g->V, sizeof(unsigned char));
+    size_t head = 0, tail = 0, e;
+
+    if (!queue || !visited)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(queue);
+        free(visited);
+        return;
+    }
+
+    queue[tail++] = src;
+    visited[src] = 1;
+
+    while (head < tail)
+    {
+        vertex_t u = queue[head++];
+        printf("Vertex : %" PRIvtx "\n", u);
+
+        for (e = g->offsets[u]; e < g->offsets[u + 1]; ++e)
+        {
+            vertex_t v = g->neighbors[e];
+            if (!visited[v])
+            {
+                queue[tail++] = v;
+                visited[v] = 1;
+            }
+        }
+    }
+
+    free(queue);
+    free(visited);
+}
+
+/* Breadth First Search into caller-provided arrays, no I/O */
+
+// fill dist[] with the no. of edges from src to every vertex and, if
+// parent is not NULL, parent[] with the BFS tree; NO_VERTEX marks the
+// unreachable vertices and the parent of src. The queue is one flat
+// array of V entries, allocated once, in which each level follows
+// the previous one.
+// returns the no. of edges examined, or SIZE_MAX on memory error
+// or an invalid source
+size_t BFSInto(CsrGraph* g, vertex_t src, vertex_t* dist, vertex_t* parent)
+{
+    if (src >= g->V)
+    {
+        fprintf(stderr, "[ERROR] Invalid source vertex %" PRIvtx "\n", src);
+        return SIZE_MAX;
+    }
+
+    vertex_t* queue = (vertex_t* )malloc((g->V ? g->V : 1) * sizeof(vertex_t));
+    size_t head = 0, tail = 0, edges = 0, v, e;
+
+    if (!queue)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return SIZE_MAX;
+    }
+
+    for (v = 0; v < g->V; ++v)
+        dist[v] = NO_VERTEX;
+    if (parent)
+        for (v = 0; v < g->V; ++v)
+            parent[v] = NO_VERTEX;
+
+    queue[tail++] = src;
+    dist[src] = 0;
+
+    while (head < tail)
+    {
+        vertex_t u = queue[head++], d = dist[u] + 1;
+        size_t first = g->offsets[u], last = g->offsets[u + 1];
+
+        edges += last - first;
+        for (e = first; e < last; ++e)
+        {
+            vertex_t w = g->neighbors[e];
+            if (dist[w] == NO_VERTEX)
+            {
+                dist[w] = d;
+                if (parent)
+                    parent[w] = u;
+                queue[tail++] = w;
+            }
+        }
+    }
+
+    free(queue);
+    return edges;
+}
+
+/* Direction-optimizing Breadth First Search */
+
+// switch to bottom-up when the frontier's edges exceed
+// 1 / BFS_ALPHA of the edges of the unvisited vertices
+#define BFS_ALPHA 14
+
+// switch back to top-down when the frontier shrinks
+// below 1 / BFS_BETA of the vertices
+#define BFS_BETA  24
+
+/* BFS tree of a direction-optimizing search */
+typedef struct BfsTree
+{
+    vertex_t* parent;        // parent in the BFS tree, NO_VERTEX for
+                             // the source & unreachable vertices
+    vertex_t* depth;         // distance from source in edges, NO_VERTEX
+                             // if unreachable
+    size_t    edgesExamined; // edges looked at, in both directions
+    unsigned  topDown;       // no. of top-down levels
+    unsigned  bottomUp;      // no. of bottom-up levels
+} BfsTree;
+
+// destroy a BFS tree
+void destroyBfsTree(BfsTree* t)
+{
+    free(t->parent);
+    free(t->depth);
+    free(t);
+}
+
+// Breadth First Search that expands each level either top-down, from
+// the frontier queue to its unvisited neighbours, or bottom-up, with
+// every unvisited vertex looking for a parent in a bitmap of the
+// frontier and stopping at the first one found. Bottom-up wins on the
+// middle levels of low-diameter graphs, where the frontier holds most
+// of the edges and nearly every neighbour is already visited.
+//  => in - the in-edges of g, i.e. its transpose, for the bottom-up
+//          levels; g itself if g is undirected (symmetric)
+// returns NULL on memory error or an invalid source
+BfsTree* BFSDirOpt(CsrGraph* g, CsrGraph* in, vertex_t src)
+{
+    if (src >= g->V)
+    {
+        fprintf(stderr, "[ERROR] Invalid source vertex %" PRIvtx "\n", src);
+        return NULL;
+    }
+
+    size_t V = g->V, words = (V + 63) / 64, u, v, e;
+    BfsTree* t = (BfsTree* )malloc(sizeof(BfsTree));
+    vertex_t* queue = (vertex_t* )malloc((V ? V : 1) * sizeof(vertex_t));
+    uint64_t* front = (uint64_t* )calloc(words ? words : 1, sizeof(uint64_t));
+    uint64_t* next = (uint64_t* )calloc(words ? words : 1, sizeof(uint64_t));
+
+    if (t)
+    {
+        t->parent = (vertex_t* )malloc((V ? V : 1) * sizeof(vertex_t));
+        t->depth = (vertex_t* )malloc((V ? V : 1) * sizeof(vertex_t));
+        t->edgesExamined = 0;
+        t->topDown = t->bottomUp = 0;
+    }
+
+    if (!t || !t->parent || !t->depth || !queue || !front || !next)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        if (t)
+            destroyBfsTree(t);
+        free(queue);
+        free(front);
+        free(next);
+        return NULL;
+    }
+
+    for (v = 0; v < V; ++v)
+        t->parent[v] = t->depth[v] = NO_VERTEX;
+
+    // the frontier is either queue[0 .. nf) or the bitmap `front`
+    size_t nf = 1, mf = g->offsets[src + 1] - g->offsets[src], mu = g->E;
+    int bottomUp = 0;
+    vertex_t level = 0;
+
+    queue[0] = src;
+    t->depth[src] = 0;
+
+    while (nf)
+    {
+        mu -= mf;
+
+        // switch on the edges out of the frontier (mf) against the
+        // edges still to be checked (mu), and switch back once the
+        // frontier is small again
+        if (!bottomUp && mf > mu / BFS_ALPHA)
+        {
+            memset(front, 0, words * sizeof(uint64_t));
+            for (u = 0; u < nf; ++u)
+                front[queue[u] / 64] |= (uint64_t)1 << (queue[u] % 64);
+            bottomUp = 1;
+        }
+        else if (bottomUp && nf < V / BFS_BETA)
+        {
+            size_t n = 0;
+            for (u = 0; u < V; ++u)
+                if (front[u / 64] >> (u % 64) & 1)
+                    queue[n++] = (vertex_t)u;
+            bottomUp = 0;
+        }
+
+        size_t count = 0;
+        mf = 0;
+        ++level;
+
+        if (!bottomUp)
+        {
+            // top-down : the next frontier is appended behind the
+            // current one, which is then moved to the front
+            size_t tail = nf;
+            for (u = 0; u < nf; ++u)
+            {
+                t->edgesExamined += g->offsets[queue[u] + 1] - g->offsets[queue[u]];
+                for (e = g->offsets[queue[u]]; e < g->offsets[queue[u] + 1]; ++e)
+                {
+                    v = g->neighbors[e];
+                    if (t->depth[v] == NO_VERTEX)
+                    {
+                        t->depth[v] = level;
+                        t->parent[v] = queue[u];
+                        queue[tail++] = (vertex_t)v;
+                        mf += g->offsets[v + 1] - g->offsets[v];
+                    }
+                }
+            }
+
+            count = tail - nf;
+            memmove(queue, queue + nf, count * sizeof(vertex_t));
+            t->topDown++;
+        }
+        else
+        {
+            // bottom-up : each unvisited vertex stops at the first
+            // in-neighbour found in the frontier
+            memset(next, 0, words * sizeof(uint64_t));
+            for (v = 0; v < V; ++v)
+            {
+                if (t->depth[v] != NO_VERTEX)
+                    continue;
+
+                for (e = in->offsets[v]; e < in->offsets[v + 1]; ++e)
+                {
+                    u = in->neighbors[e];
+                    if (front[u / 64] >> (u % 64) & 1)
+                    {
+                        t->depth[v] = level;
+                        t->parent[v] = (vertex_t)u;
+                        next[v / 64] |= (uint64_t)1 << (v % 64);
+                        mf += g->offsets[v + 1] - g->offsets[v];
+                        ++count;
+                        ++e;
+                        break;
+                    }
+                }
+                t->edgesExamined += e - in->offsets[v];
+            }
+
+            uint64_t* swap = front;
+            front = next;
+            next = swap;
+            t->bottomUp++;
+        }
+
+        nf = count;
+    }
+
+    free(queue);
+    free(front);
+    free(next);
+    return t;
+}
+
+/* Parallel level-synchronous Breadth First Search, compile with -pthread */
+
+// frontier vertices a thread takes at a time
+#define BFS_CHUNK 64
+
+// entries of a thread's buffer for the next frontier
+#define BFS_LOCAL 512
+
+/* A barrier whose no. of threads can be lowered before first use */
+typedef struct LevelBarrier
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    unsigned        total;   // threads to wait for
+    unsigned        waiting; // threads waiting now
+    unsigned        phase;   // no. of times the barrier opened
+} LevelBarrier;
+
+/* State shared by the threads of one search */
+typedef struct BfsShared
+{
+    CsrGraph*    g;
+    BfsTree*     t;
+    vertex_t*    frontier; // current level
+    vertex_t*    next;     // next level, filled in blocks
+    size_t       nf;       // size of the current level
+    size_t       cursor;   // next unclaimed chunk of the frontier
+    size_t       nn;       // size of the next level so far
+    vertex_t     level;    // depth of the next level
+    size_t*      edges;    // edges examined, one count per thread
+    LevelBarrier barrier;
+} BfsShared;
+
+/* A thread of the search */
+typedef struct BfsWorker
+{
+    BfsShared* shared;
+    unsigned   id; // 0 is the calling thread
+} BfsWorker;
+
+// wait until `total` threads have called it
+void barrierWait(LevelBarrier* b)
+{
+    pthread_mutex_lock(&b->lock);
+    unsigned phase = b->phase;
+
+    if (++b->waiting == b->total)
+    {
+        b->waiting = 0;
+        b->phase++;
+        pthread_cond_broadcast(&b->cond);
+    }
+    else
+        while (phase == b->phase)
+            pthread_cond_wait(&b->cond, &b->lock);
+
+    pthread_mutex_unlock(&b->lock);
+}
+
+// append a thread's buffer to the next level
+void flushLocal(BfsShared* s, const vertex_t* local, size_t n)
+{
+    size_t at = __atomic_fetch_add(&s->nn, n, __ATOMIC_RELAXED);
+    memcpy(s->next + at, local, n * sizeof(vertex_t));
+}
+
+// expand chunks of each level until the search ends
+void* bfsWorker(void* arg)
+{
+    BfsWorker* w = (BfsWorker* )arg;
+    BfsShared* s = w->shared;
+    vertex_t* parent = s->t->parent;
+    vertex_t local[BFS_LOCAL];
+    size_t edges = 0, e;
+
+    barrierWait(&s->barrier);
+
+    while (s->nf)
+    {
+        size_t n = 0, first;
+
+        while ((first = __atomic_fetch_add(&s->cursor, BFS_CHUNK, __ATOMIC_RELAXED)) < s->nf)
+        {
+            size_t last = first + BFS_CHUNK < s->nf ? first + BFS_CHUNK : s->nf;
+
+            for (; first < last; ++first)
+            {
+                vertex_t u = s->frontier[first];
+                edges += s->g->offsets[u + 1] - s->g->offsets[u];
+
+                for (e = s->g->offsets[u]; e < s->g->offsets[u + 1]; ++e)
+                {
+                    vertex_t v = s->g->neighbors[e], none = NO_VERTEX;
+
+                    // a plain load filters out most visited vertices,
+                    // and the CAS lets exactly one thread claim v
+                    if (__atomic_load_n(&parent[v], __ATOMIC_RELAXED) != NO_VERTEX ||
+                        !__atomic_compare_exchange_n(&parent[v], &none, u, 0,
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                        continue;
+
+                    s->t->depth[v] = s->level;
+                    local[n++] = v;
+                    if (n == BFS_LOCAL)
+                    {
+                        flushLocal(s, local, n);
+                        n = 0;
+                    }
+                }
+            }
+        }
+
+        if (n)
+            flushLocal(s, local, n);
+
+        // the first barrier ends the level, the calling thread then
+        // swaps the levels, and the second one starts the next level
+        barrierWait(&s->barrier);
+        if (w->id == 0)
+        {
+            vertex_t* swap = s->frontier;
+            s->frontier = s->next;
+            s->next = swap;
+            s->nf = s->nn;
+            s->nn = 0;
+            s->cursor = 0;
+            s->level++;
+            s->t->topDown++;
+        }
+        barrierWait(&s->barrier);
+    }
+
+    s->edges[w->id] = edges;
+    return NULL;
+}
+
+// Breadth First Search with the frontier of each level split across
+// threads; vertices are claimed with a compare-and-swap on parent[],
+// and each thread gathers the next level in a buffer of its own,
+// appended to it in blocks. The tree may differ from a sequential
+// search's, but the depths are the same.
+//  => threads - no. of threads to use, 0 means one per online CPU
+// returns NULL on memory error or an invalid source
+BfsTree* BFSParallel(CsrGraph* g, vertex_t src, unsigned threads)
+{
+    if (src >= g->V)
+    {
+        fprintf(stderr, "[ERROR] Invalid source vertex %" PRIvtx "\n", src);
+        return NULL;
+    }
+
+    size_t V = g->V, v;
+    BfsShared s;
+    BfsTree* t = (BfsTree* )malloc(sizeof(BfsTree));
+
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+
+    BfsWorker* workers = (BfsWorker* )malloc(threads * sizeof(BfsWorker));
+    pthread_t* ids = (pthread_t* )malloc(threads * sizeof(pthread_t));
+    s.frontier = (vertex_t* )malloc((V ? V : 1) * sizeof(vertex_t));
+    s.next = (vertex_t* )malloc((V ? V : 1) * sizeof(vertex_t));
+    s.edges = (size_t* )calloc(threads, sizeof(size_t));
+
+    if (t)
+    {
+        t->parent = (vertex_t* )malloc((V ? V : 1) * sizeof(vertex_t));
+        t->depth = (vertex_t* )malloc((V ? V : 1) * sizeof(vertex_t));
+        t->edgesExamined = 0;
+        t->topDown = t->bottomUp = 0;
+    }
+
+    if (!t || !t->parent || !t->depth || !workers || !ids || !s.frontier || !s.next ||
+        !s.edges)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        if (t)
+            destroyBfsTree(t);
+        free(workers);
+        free(ids);
+        free(s.frontier);
+        free(s.next);
+        free(s.edges);
+        return NULL;
+    }
+
+    for (v = 0; v < V; ++v)
+        t->parent[v] = t->depth[v] = NO_VERTEX;
+
+    // the source is its own parent while searching,
+    // so that no thread claims it
+    t->parent[src] = src;
+    t->depth[src] = 0;
+
+    s.g = g;
+    s.t = t;
+    s.frontier[0] = src;
+    s.nf = 1;
+    s.nn = s.cursor = 0;
+    s.level = 1;
+    pthread_mutex_init(&s.barrier.lock, NULL);
+    pthread_cond_init(&s.barrier.cond, NULL);
+    s.barrier.total = threads;
+    s.barrier.waiting = s.barrier.phase = 0;
+
+    unsigned started = 0;
+    for (unsigned i = 1; i < threads; i++, started++)
+    {
+        workers[i] = (BfsWorker){ &s, i };
+        if (pthread_create(&ids[i], NULL, bfsWorker, &workers[i]))
+            break;
+    }
+
+    // go on with the threads that could be started; none
+    // of them is past the first barrier before this
+    pthread_mutex_lock(&s.barrier.lock);
+    s.barrier.total = started + 1;
+    pthread_mutex_unlock(&s.barrier.lock);
+
+    workers[0] = (BfsWorker){ &s, 0 };
+    bfsWorker(&workers[0]);
+
+    for (unsigned i = 1; i <= started; i++)
+        pthread_join(ids[i], NULL);
+
+    for (unsigned i = 0; i <= started; i++)
+        t->edgesExamined += s.edges[i];
+    t->parent[src] = NO_VERTEX;
+
+    pthread_mutex_destroy(&s.barrier.lock);
+    pthread_cond_destroy(&s.barrier.cond);
+    free(workers);
+    free(ids);
+    free(s.frontier);
+    free(s.next);
+    free(s.edges);
+    return t;
+}
+
 /* Unit tests */
 
 // test 1 : Test queue implementation
@@ -319,6 +981,285 @@ void test3()
     destroyGraph(g);
 }
 
+// test 4 : Test BFS traversal on a CSR graph
+void test4()
+{
+    // the graph of test 3, as a list of undirected edges
+    Edge edges[] = { { 0, 1, 0 }, { 1, 2, 0 }, { 1, 7, 0 }, { 2, 3, 0 },
+                     { 2, 4, 0 }, { 4, 5, 0 }, { 4, 6, 0 }, { 4, 7, 0 } };
+
+    printf("\nUnit test : Test Breadth-First Search on a CSR graph\n\n");
+
+    CsrGraph* g = csrFromEdges(8, edges, sizeof(edges) / sizeof(edges[0]), 0, 1);
+    if (!g)
+        return;
+
+    printf("Displaying graph :-\n");
+    displayCsrGraph(g);
+
+    printf("\nUsing Breadth-First Search to traverse the graph :-\n");
+    BFSCsr(g, 0);
+
+    destroyCsrGraph(g);
+}
+
+// undirected side x side grid graph, like a road network
+CsrGraph* gridGraph(size_t side)
+{
+    size_t E = 0, r, c;
+    Edge* edges = (Edge* )malloc(2 * side * side * sizeof(Edge));
+    if (!edges)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return NULL;
+    }
+
+    for (r = 0; r < side; ++r)
+        for (c = 0; c < side; ++c)
+        {
+            if (c + 1 < side)
+                edges[E++] = (Edge){ r * side + c, r * side + c + 1, 0 };
+            if (r + 1 < side)
+                edges[E++] = (Edge){ r * side + c, (r + 1) * side + c, 0 };
+        }
+
+    CsrGraph* g = csrFromEdges(side * side, edges, E, 0, 1);
+    free(edges);
+    return g;
+}
+
+// test 5 : Test the size of a large sparse graph
+void test5()
+{
+    // a 1000 x 1000 grid, like a road network
+    CsrGraph* g = gridGraph(1000);
+    if (!g)
+        return;
+
+    printf("\nGrid of %zu vertices and %zu directed edges :-\n", g->V, g->E);
+    printf("CSR graph        : %.1f MB\n",
+           ((g->V + 1) * sizeof(size_t) + g->E * sizeof(vertex_t)) / 1e6);
+    printf("adjacency matrix : %.1f TB\n", (double)g->V * g->V * sizeof(int) / 1e12);
+
+    destroyCsrGraph(g);
+}
+
+// undirected R-MAT graph of 2^scale vertices and `perVertex` edges
+// per vertex, with the skewed degrees and small diameter of a social
+// network; vertex 0 is the largest hub
+CsrGraph* rmatGraph(size_t scale, size_t perVertex)
+{
+    size_t V = (size_t)1 << scale, E = perVertex * V, i, b;
+    Edge* edges = (Edge* )malloc(E * sizeof(Edge));
+    if (!edges)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return NULL;
+    }
+
+    srand(1);
+    for (i = 0; i < E; ++i)
+    {
+        vertex_t u = 0, v = 0;
+        for (b = 0; b < scale; ++b)
+        {
+            double r = rand() / (RAND_MAX + 1.0);
+            u = 2 * u + (r >= 0.76);
+            v = 2 * v + (r >= 0.57 && r < 0.76) + (r >= 0.95);
+        }
+        edges[i] = (Edge){ u, v, 0 };
+    }
+
+    CsrGraph* g = csrFromEdges(V, edges, E, 0, 1);
+    free(edges);
+    return g;
+}
+
+// milliseconds since `start`
+double elapsed(struct timespec start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+// test 6 : Test direction-optimizing BFS on a scale-free graph
+void test6()
+{
+    size_t V = (size_t)1 << 16, i, e;
+    CsrGraph* g = rmatGraph(16, 16);
+    if (!g)
+        return;
+
+    BfsTree* t = BFSDirOpt(g, g, 0);
+    if (!t)
+    {
+        destroyCsrGraph(g);
+        return;
+    }
+
+    // a top-down search examines every edge of every reached vertex;
+    // the tree is checked against the edges : tree edges go down one
+    // level, and no edge skips a level
+    size_t reached = 0, topDownEdges = 0, bad = 0;
+    for (i = 0; i < V; ++i)
+    {
+        if (t->depth[i] == NO_VERTEX)
+            continue;
+
+        ++reached;
+        topDownEdges += g->offsets[i + 1] - g->offsets[i];
+
+        if (i != 0 && (t->parent[i] == NO_VERTEX || t->depth[t->parent[i]] + 1 != t->depth[i]))
+            ++bad;
+
+        for (e = g->offsets[i]; e < g->offsets[i + 1]; ++e)
+            if (t->depth[g->neighbors[e]] == NO_VERTEX ||
+                t->depth[g->neighbors[e]] + 1 < t->depth[i])
+                ++bad;
+    }
+
+    printf("\nDirection-optimizing BFS on an R-MAT graph of %zu vertices, %zu edges :-\n",
+           g->V, g->E);
+    printf("reached %zu vertices in %u top-down and %u bottom-up levels, %zu bad tree edges\n",
+           reached, t->topDown, t->bottomUp, bad);
+    printf("edges examined : %zu, against %zu top-down only (%.1fx fewer)\n",
+           t->edgesExamined, topDownEdges, (double)topDownEdges / t->edgesExamined);
+
+    destroyBfsTree(t);
+    destroyCsrGraph(g);
+}
+
+// test 7 : Test the scaling of parallel BFS with the no. of threads
+void test7()
+{
+    size_t V = (size_t)1 << 20, i;
+    CsrGraph* g = rmatGraph(20, 16);
+    if (!g)
+        return;
+
+    BfsTree* ref = BFSDirOpt(g, g, 0);
+    if (!ref)
+    {
+        destroyCsrGraph(g);
+        return;
+    }
+
+    printf("\nParallel BFS on an R-MAT graph of %zu vertices, %zu edges, %ld CPUs online :-\n",
+           g->V, g->E, sysconf(_SC_NPROCESSORS_ONLN));
+
+    double base = 0;
+    for (unsigned threads = 1; threads <= 16; threads *= 2)
+    {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        BfsTree* t = BFSParallel(g, 0, threads);
+        double ms = elapsed(start);
+        if (!t)
+            break;
+
+        size_t wrong = 0;
+        for (i = 0; i < V; ++i)
+            wrong += t->depth[i] != ref->depth[i];
+
+        if (threads == 1)
+            base = ms;
+        printf("%2u threads : %8.2f ms, %7.1f M edges/s, speedup %.2fx, %zu wrong depths\n",
+               threads, ms, t->edgesExamined / ms / 1e3, base / ms, wrong);
+
+        destroyBfsTree(t);
+    }
+
+    destroyBfsTree(ref);
+    destroyCsrGraph(g);
+}
+
+// test 8 : Test the throughput of BFS into arrays, in traversed
+// edges per second, against a linked-list queue
+void test8()
+{
+    CsrGraph* graphs[2] = { gridGraph(1000), rmatGraph(18, 16) };
+    const char* names[2] = { "1000 x 1000 grid", "R-MAT, 2^18 vertices" };
+    size_t i, e;
+
+    printf("\nBFS throughput :-\n");
+    for (int k = 0; k < 2 && graphs[k]; k++)
+    {
+        CsrGraph* g = graphs[k];
+        vertex_t* dist = (vertex_t* )malloc(g->V * sizeof(vertex_t));
+        vertex_t* parent = (vertex_t* )malloc(g->V * sizeof(vertex_t));
+        unsigned char* visited = (unsigned char* )malloc(g->V * sizeof(unsigned char));
+        if (!dist || !parent || !visited)
+        {
+            free(dist);
+            free(parent);
+            free(visited);
+            break;
+        }
+
+        Queue* q = newQueue();
+        size_t traversed = 0, mismatches = 0;
+        double ms = 1e30, queueMs = 1e30;
+
+        // best of 3 runs of each
+        for (int rep = 0; rep < 3; rep++)
+        {
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            traversed = BFSInto(g, 0, dist, parent);
+            if (traversed == SIZE_MAX)
+                break;
+            double t = elapsed(start);
+            ms = t < ms ? t : ms;
+
+            // the same search with the malloc-per-enqueue Queue
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            memset(visited, 0, g->V * sizeof(unsigned char));
+            enqueue(q, 0);
+            visited[0] = 1;
+            while (q->head != NULL)
+            {
+                unsigned u = dequeue(q);
+                for (e = g->offsets[u]; e < g->offsets[u + 1]; ++e)
+                    if (!visited[g->neighbors[e]])
+                    {
+                        enqueue(q, g->neighbors[e]);
+                        visited[g->neighbors[e]] = 1;
+                    }
+            }
+            t = elapsed(start);
+            queueMs = t < queueMs ? t : queueMs;
+        }
+
+        // a failed search leaves dist[] and visited[] unfilled
+        if (traversed == SIZE_MAX)
+        {
+            printf("%-21s : skipped, BFSInto failed\n", names[k]);
+            free(visited);
+            destroyQueue(q);
+            free(dist);
+            free(parent);
+            continue;
+        }
+
+        for (i = 0; i < g->V; ++i)
+            mismatches += visited[i] != (dist[i] != NO_VERTEX);
+
+        printf("%-21s : BFSInto %7.2f ms, %6.1f M TEPS; Queue %7.2f ms, %6.1f M TEPS;"
+               " %zu mismatches\n", names[k], ms, traversed / ms / 1e3, queueMs,
+               traversed / queueMs / 1e3, mismatches);
+
+        free(visited);
+        destroyQueue(q);
+        free(dist);
+        free(parent);
+    }
+
+    for (int k = 0; k < 2; k++)
+        if (graphs[k])
+            destroyCsrGraph(graphs[k]);
+}
+
 int main()
 {
     // UNIT TESTS
@@ -332,6 +1273,21 @@ int main()
         
     // Test 3 : Test BFS traversal implementation
     test3();
+
+    // Test 4 : Test BFS traversal on a CSR graph
+    test4();
+
+    // Test 5 : Test the size of a large sparse graph
+    test5();
+
+    // Test 6 : Test direction-optimizing BFS on a scale-free graph
+    test6();
+
+    // Test 7 : Test the scaling of parallel BFS with the no. of threads
+    test7();
+
+    // Test 8 : Test the throughput of BFS into arrays
+    test8();
         
     return EXIT_SUCCESS;
 }
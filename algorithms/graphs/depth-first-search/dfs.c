@@ -1,14 +1,23 @@
 /*
  * Depth-first Search graph traversal
  * ----------------------------------
- * Uses adjacency matrix for storing graph
+ * Uses adjacency matrix for storing graph, or a compressed
+ * sparse row (CSR) graph for large sparse ones
+ *
+ * Strongly connected components (Tarjan) and topological
+ * sort run on an iterative DFS engine with an explicit
+ * stack, so deep graphs can't overflow the call stack
  *
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <math.h>
+#include <time.h>
 
 /* Node structure */
 typedef struct Node
@@ -197,6 +206,139 @@ void displayGraph(Graph* g)
     }
 }
 
+/* Compressed sparse row (CSR) graph */
+
+// vertex ids are 32-bit, or 64-bit when compiled with -DCSR_64BIT_IDS
+#ifdef CSR_64BIT_IDS
+typedef uint64_t vertex_t;
+#define PRIvtx PRIu64
+#else
+typedef uint32_t vertex_t;
+#define PRIvtx PRIu32
+#endif
+
+// no vertex, e.g. the parent of the source
+#define NO_VERTEX ((vertex_t)-1)
+
+typedef struct CsrGraph
+{
+    size_t    V;         // |V|
+    size_t    E;         // no. of directed edges
+    size_t*   offsets;   // V + 1 entries, the edges of u are
+                         // [offsets[u], offsets[u + 1])
+    vertex_t* neighbors; // E entries, the head of each edge
+    int*      weights;   // E entries, or NULL if unweighted
+} CsrGraph;
+
+/* An edge of an edge list */
+typedef struct Edge
+{
+    vertex_t u; // tail
+    vertex_t v; // head
+    int      w; // weight, ignored for unweighted graphs
+} Edge;
+
+/* CSR graph helper methods */
+
+// destroy graph
+void destroyCsrGraph(CsrGraph* g)
+{
+    free(g->offsets);
+    free(g->neighbors);
+    free(g->weights);
+    free(g);
+}
+
+// build a graph of V vertices from E edges in O(V + E); the edges of
+// each vertex keep their order in the list
+//  => weighted  - keep the weights of the edges
+//  => symmetric - also add (v, u) for every edge (u, v), for
+//                 undirected graphs
+// returns NULL on memory error or on an invalid vertex
+CsrGraph* csrFromEdges(size_t V, const Edge* edges, size_t E, int weighted, int symmetric)
+{
+    size_t M = symmetric ? 2 * E : E, i;
+    CsrGraph* g = (CsrGraph* )malloc(sizeof(CsrGraph));
+    size_t* next = (size_t* )malloc((V + 1) * sizeof(size_t));
+
+    if (g)
+    {
+        g->V = V;
+        g->E = M;
+        g->offsets = (size_t* )calloc(V + 1, sizeof(size_t));
+        g->neighbors = (vertex_t* )malloc((M ? M : 1) * sizeof(vertex_t));
+        g->weights = weighted ? (int* )malloc((M ? M : 1) * sizeof(int)) : NULL;
+    }
+
+    if (!g || !next || !g->offsets || !g->neighbors || (weighted && !g->weights))
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(next);
+        if (g)
+            destroyCsrGraph(g);
+        return NULL;
+    }
+
+    // Step 1 : count the edges of every vertex, one slot ahead
+    for (i = 0; i < E; ++i)
+    {
+        if (edges[i].u >= V || edges[i].v >= V)
+        {
+            fprintf(stderr, "[ERROR] Invalid edge %" PRIvtx " -> %" PRIvtx "\n",
+                    edges[i].u, edges[i].v);
+            free(next);
+            destroyCsrGraph(g);
+            return NULL;
+        }
+
+        g->offsets[edges[i].u + 1]++;
+        if (symmetric)
+            g->offsets[edges[i].v + 1]++;
+    }
+
+    // Step 2 : prefix sums turn the counts into offsets
+    for (i = 0; i < V; ++i)
+        g->offsets[i + 1] += g->offsets[i];
+
+    // Step 3 : drop every edge in the next free slot of its tail
+    memcpy(next, g->offsets, (V + 1) * sizeof(size_t));
+    for (i = 0; i < E; ++i)
+    {
+        size_t at = next[edges[i].u]++;
+        g->neighbors[at] = edges[i].v;
+        if (weighted)
+            g->weights[at] = edges[i].w;
+
+        if (symmetric)
+        {
+            at = next[edges[i].v]++;
+            g->neighbors[at] = edges[i].u;
+            if (weighted)
+                g->weights[at] = edges[i].w;
+        }
+    }
+
+    free(next);
+    return g;
+}
+
+// print the edges of every vertex
+void displayCsrGraph(CsrGraph* g)
+{
+    for (size_t u = 0; u < g->V; ++u)
+    {
+        printf("%zu :", u);
+        for (size_t e = g->offsets[u]; e < g->offsets[u + 1]; ++e)
+        {
+            if (g->weights)
+                printf(" %" PRIvtx "(%d)", g->neighbors[e], g->weights[e]);
+            else
+                printf(" %" PRIvtx, g->neighbors[e]);
+        }
+        printf("\n");
+    }
+}
+
 /* Depth-first Search traversal */
 void DFS(Graph* g, unsigned src)
 {
@@ -231,13 +373,249 @@ void DFS(Graph* g, unsigned src)
     free(visited);
 }
 
+/* Iterative Depth-first Search engine */
+
+/* Callbacks of a DFS, any of which may be NULL */
+typedef struct DfsVisitor
+{
+    void* ctx; // passed to every callback
+
+    // v is reached for the first time
+    void (*discover)(void* ctx, vertex_t v);
+
+    // edge u -> v to an already discovered v; open is set if v is
+    // still on the DFS path, i.e. the edge closes a cycle
+    void (*edge)(void* ctx, vertex_t u, vertex_t v, int open);
+
+    // all the edges of v are done; parent is NO_VERTEX for a root
+    void (*finish)(void* ctx, vertex_t v, vertex_t parent);
+} DfsVisitor;
+
+// Depth-first search from src, or from every undiscovered vertex in
+// the order 0 .. V - 1 if src is NO_VERTEX, calling back the visitor.
+// The DFS path lives in two flat arrays, the vertex & its next edge
+// at each depth, so it takes O(V + E) time and O(V) memory however
+// deep the search goes.
+// returns 0 on success, -1 on memory error or an invalid source
+int dfsVisit(CsrGraph* g, vertex_t src, DfsVisitor* vis)
+{
+    if (src != NO_VERTEX && src >= g->V)
+    {
+        fprintf(stderr, "[ ERROR ] Invalid source vertex %" PRIvtx "\n", src);
+        return -1;
+    }
+
+    vertex_t* path = (vertex_t* )malloc((g->V ? g->V : 1) * sizeof(vertex_t));
+    size_t* next = (size_t* )malloc((g->V ? g->V : 1) * sizeof(size_t));
+
+    // 0 : undiscovered, 1 : on the DFS path, 2 : finished
+    unsigned char* state = (unsigned char* )calloc(g->V ? g->V : 1, sizeof(unsigned char));
+
+    if (!path || !next || !state)
+    {
+        fprintf(stderr, "[ ERROR ] Memory error");
+        free(path);
+        free(next);
+        free(state);
+        return -1;
+    }
+
+    size_t first = src == NO_VERTEX ? 0 : src;
+    size_t last = src == NO_VERTEX ? g->V : (size_t)src + 1;
+
+    for (size_t root = first; root < last; ++root)
+    {
+        if (state[root])
+            continue;
+
+        size_t top = 0;
+        path[top] = (vertex_t)root;
+        next[top++] = g->offsets[root];
+        state[root] = 1;
+        if (vis->discover)
+            vis->discover(vis->ctx, (vertex_t)root);
+
+        while (top > 0)
+        {
+            vertex_t u = path[top - 1];
+
+            if (next[top - 1] < g->offsets[u + 1])
+            {
+                // go down the next edge of u
+                vertex_t w = g->neighbors[next[top - 1]++];
+
+                if (!state[w])
+                {
+                    path[top] = w;
+                    next[top++] = g->offsets[w];
+                    state[w] = 1;
+                    if (vis->discover)
+                        vis->discover(vis->ctx, w);
+                }
+                else if (vis->edge)
+                    vis->edge(vis->ctx, u, w, state[w] == 1);
+            }
+            else
+            {
+                // u is done, back up to its parent
+                state[u] = 2;
+                --top;
+                if (vis->finish)
+                    vis->finish(vis->ctx, u, top ? path[top - 1] : NO_VERTEX);
+            }
+        }
+    }
+
+    free(path);
+    free(next);
+    free(state);
+    return 0;
+}
+
+void printDiscover(void* ctx, vertex_t v)
+{
+    (void)ctx;
+    printf("Current Vertex : %" PRIvtx "\n", v);
+}
+
+/* Depth-first Search traversal on a CSR graph, in O(V + E) */
+void DFSCsr(CsrGraph* g, vertex_t src)
+{
+    DfsVisitor vis = { NULL, printDiscover, NULL, NULL };
+    dfsVisit(g, src, &vis);
+}
+
+/* Strongly connected components, Tarjan's algorithm */
+
+/* State of Tarjan's algorithm */
+typedef struct TarjanState
+{
+    vertex_t* index; // discovery order of each vertex
+    vertex_t* low;   // lowest index reachable from its subtree
+                     // through vertices still on the stack
+    vertex_t* stack; // discovered vertices without a component
+    size_t    top;
+    vertex_t* comp;  // component of each vertex, NO_VERTEX while
+                     // it's on the stack
+    vertex_t  count; // vertices discovered
+    size_t    comps; // components found
+} TarjanState;
+
+void tarjanDiscover(void* ctx, vertex_t v)
+{
+    TarjanState* t = (TarjanState* )ctx;
+    t->index[v] = t->low[v] = t->count++;
+    t->stack[t->top++] = v;
+}
+
+void tarjanEdge(void* ctx, vertex_t u, vertex_t v, int open)
+{
+    TarjanState* t = (TarjanState* )ctx;
+    (void)open;
+
+    // a finished v still on the stack is in u's component too
+    if (t->comp[v] == NO_VERTEX && t->index[v] < t->low[u])
+        t->low[u] = t->index[v];
+}
+
+void tarjanFinish(void* ctx, vertex_t v, vertex_t parent)
+{
+    TarjanState* t = (TarjanState* )ctx;
+
+    // v is the root of a component : pop it off the stack
+    if (t->low[v] == t->index[v])
+    {
+        vertex_t w;
+        do
+        {
+            w = t->stack[--t->top];
+            t->comp[w] = (vertex_t)t->comps;
+        } while (w != v);
+        t->comps++;
+    }
+
+    if (parent != NO_VERTEX && t->low[v] < t->low[parent])
+        t->low[parent] = t->low[v];
+}
+
+// find the strongly connected components of g in O(V + E) time and
+// O(V) memory; comp[v] gets the component of v, numbered from 0 in
+// reverse topological order : an edge u -> v has comp[u] >= comp[v]
+// returns the no. of components, or SIZE_MAX on memory error
+size_t tarjanScc(CsrGraph* g, vertex_t* comp)
+{
+    size_t V = g->V ? g->V : 1, v;
+    TarjanState t = { (vertex_t* )malloc(V * sizeof(vertex_t)),
+                      (vertex_t* )malloc(V * sizeof(vertex_t)),
+                      (vertex_t* )malloc(V * sizeof(vertex_t)), 0, comp, 0, 0 };
+    DfsVisitor vis = { &t, tarjanDiscover, tarjanEdge, tarjanFinish };
+
+    if (!t.index || !t.low || !t.stack)
+    {
+        fprintf(stderr, "[ ERROR ] Memory error");
+        free(t.index);
+        free(t.low);
+        free(t.stack);
+        return SIZE_MAX;
+    }
+
+    for (v = 0; v < g->V; ++v)
+        comp[v] = NO_VERTEX;
+
+    int err = dfsVisit(g, NO_VERTEX, &vis);
+
+    free(t.index);
+    free(t.low);
+    free(t.stack);
+    return err ? SIZE_MAX : t.comps;
+}
+
+/* Topological sort */
+
+/* State of a topological sort */
+typedef struct TopoState
+{
+    vertex_t* order; // filled from the back
+    size_t    pos;   // first filled slot
+    int       cycle; // set if an edge closes a cycle
+} TopoState;
+
+void topoEdge(void* ctx, vertex_t u, vertex_t v, int open)
+{
+    (void)u;
+    (void)v;
+    if (open)
+        ((TopoState* )ctx)->cycle = 1;
+}
+
+void topoFinish(void* ctx, vertex_t v, vertex_t parent)
+{
+    TopoState* t = (TopoState* )ctx;
+    (void)parent;
+    t->order[--t->pos] = v;
+}
+
+// fill order[0 .. V) with the vertices of g such that every edge
+// u -> v has u before v : the vertices in reverse order of finishing
+// returns 1 on success, 0 if g has a cycle (order is then not
+// topological), -1 on memory error
+int topoSort(CsrGraph* g, vertex_t* order)
+{
+    TopoState t = { order, g->V, 0 };
+    DfsVisitor vis = { &t, NULL, topoEdge, topoFinish };
+
+    if (dfsVisit(g, NO_VERTEX, &vis))
+        return -1;
+    return !t.cycle;
+}
+
 /* utility methods */
 
 // create adjacency matrix
 unsigned** createAdjMatrix(size_t size)
 {
     size_t i = 0;
-    unsigned** adj = (unsigned** )malloc(size * sizeof(unsigned));
+    unsigned** adj = (unsigned** )malloc(size * sizeof(unsigned* ));
     while (i < size)
         adj[i++] = (unsigned* )malloc(size * sizeof(unsigned));
     return adj;
@@ -341,6 +719,134 @@ void test1()
     destroyGraph(g);
 }
 
+/* test 2 : test DFS traversal on a CSR graph */
+void test2()
+{
+    // the graph of test 1, as a list of undirected edges
+    Edge edges[] = { { 0, 1, 0 }, { 1, 2, 0 }, { 1, 7, 0 }, { 2, 3, 0 },
+                     { 2, 4, 0 }, { 4, 5, 0 }, { 4, 6, 0 }, { 4, 7, 0 } };
+
+    CsrGraph* g = csrFromEdges(8, edges, sizeof(edges) / sizeof(edges[0]), 0, 1);
+    if (!g)
+        return;
+
+    printf("\n");
+    displayCsrGraph(g);
+    DFSCsr(g, 0);
+
+    destroyCsrGraph(g);
+}
+
+/* test 3 : test strongly connected components & topological sort */
+void test3()
+{
+    // three cycles, {0, 1, 2}, {3, 4, 5} & {6, 7}, chained together
+    Edge cyclic[] = { { 0, 1, 0 }, { 1, 2, 0 }, { 2, 0, 0 }, { 2, 3, 0 }, { 3, 4, 0 },
+                      { 4, 5, 0 }, { 5, 3, 0 }, { 6, 5, 0 }, { 6, 7, 0 }, { 7, 6, 0 } };
+
+    // dependencies, u -> v if u must come before v
+    Edge dag[] = { { 5, 2, 0 }, { 5, 0, 0 }, { 4, 0, 0 },
+                   { 4, 1, 0 }, { 2, 3, 0 }, { 3, 1, 0 } };
+
+    vertex_t out[8];
+    size_t i, n;
+
+    CsrGraph* g = csrFromEdges(8, cyclic, sizeof(cyclic) / sizeof(cyclic[0]), 0, 0);
+    if (!g)
+        return;
+
+    printf("\n");
+    displayCsrGraph(g);
+    n = tarjanScc(g, out);
+    printf("%zu strongly connected components :", n);
+    for (i = 0; i < g->V; ++i)
+        printf(" %zu->%" PRIvtx, i, out[i]);
+    printf("\n");
+    destroyCsrGraph(g);
+
+    g = csrFromEdges(6, dag, sizeof(dag) / sizeof(dag[0]), 0, 0);
+    if (!g)
+        return;
+
+    printf("\n");
+    displayCsrGraph(g);
+    if (topoSort(g, out) == 1)
+    {
+        printf("Topological order :");
+        for (i = 0; i < g->V; ++i)
+            printf(" %" PRIvtx, out[i]);
+        printf("\n");
+    }
+    destroyCsrGraph(g);
+}
+
+/* test 4 : test SCC & topological sort on a deep graph */
+void test4()
+{
+    // a chain of 10M vertices, 2 edges per vertex; each vertex points
+    // to the next one & to one a little further, so the DFS path goes
+    // 10M vertices deep, far beyond what recursion would survive
+    size_t V = 10000000, E = 0, i, e;
+    Edge* edges = (Edge* )malloc((2 * V + 1) * sizeof(Edge));
+    vertex_t* out = (vertex_t* )malloc(V * sizeof(vertex_t));
+    vertex_t* pos = (vertex_t* )malloc(V * sizeof(vertex_t));
+    if (!edges || !out || !pos)
+    {
+        free(edges);
+        free(out);
+        free(pos);
+        return;
+    }
+
+    srand(1);
+    for (i = 0; i + 1 < V; ++i)
+    {
+        edges[E++] = (Edge){ i, i + 1, 0 };
+        if (i + 2 < V)
+            edges[E++] = (Edge){ i, i + 2 + rand() % (V - i - 2 < 100 ? V - i - 2 : 100), 0 };
+    }
+
+    // the second time, an edge back to the start
+    // closes a cycle through every vertex
+    edges[E] = (Edge){ V - 1, 0, 0 };
+
+    printf("\nGraph of %zu vertices :-\n", V);
+    for (int closed = 0; closed < 2; ++closed)
+    {
+        CsrGraph* g = csrFromEdges(V, edges, E + closed, 0, 0);
+        if (!g)
+            break;
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int sorted = topoSort(g, out);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double topoMs = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+
+        size_t misordered = 0;
+        for (i = 0; i < V; ++i)
+            pos[out[i]] = (vertex_t)i;
+        for (i = 0; i < V; ++i)
+            for (e = g->offsets[i]; e < g->offsets[i + 1]; ++e)
+                misordered += pos[i] > pos[g->neighbors[e]];
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        size_t comps = tarjanScc(g, out);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double sccMs = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+
+        printf("%-10s : topological sort %s (%zu edges out of order) in %.1f ms, "
+               "%zu components in %.1f ms\n", closed ? "with cycle" : "acyclic",
+               sorted == 1 ? "done" : "found a cycle", misordered, topoMs, comps, sccMs);
+
+        destroyCsrGraph(g);
+    }
+
+    free(edges);
+    free(out);
+    free(pos);
+}
+
 int main()
 {   
     /*size_t i, j, n = 5;
@@ -357,6 +863,9 @@ int main()
     displayGraph(g);
     destroyGraph(g);*/
     test1();
+    test2();
+    test3();
+    test4();
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,507 @@
+/*
+ *  Sorting benchmark
+ *  =================
+ *
+ *  Times the sorts of this repository on int arrays generated from
+ *  several distributions, over a range of sizes, and reports the
+ *  mean time per element, the throughput and the relative standard
+ *  deviation over a number of repetitions.
+ *
+ *  Every sort is verified after each repetition (outside of the
+ *  timed region), and sorts that are quadratic or otherwise limited
+ *  are skipped above a size of their own.
+ *
+ *  The sorts are pulled in by including their programs, with their
+ *  main() and the helpers whose names clash renamed, so that the
+ *  code being timed is exactly the code in the repository.
+ *
+ *  Build : gcc -O2 -pthread sortbench.c -o sortbench -lm
+ *
+ *  Usage :-
+ *
+ *   sortbench [-n min-size] [-N max-size] [-r repetitions]
+ *             [-s sort-name] [-d distribution] [-f table|csv|json]
+ *
+ *  Sizes go from min-size to max-size (default 1000 to 1000000)
+ *  in steps of 10; -s and -d restrict the run to the sorts and
+ *  distributions whose names contain the given string.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h> // for getopt()
+
+/*
+ *  The sorts
+ */
+
+#define main            isortIntMain
+#define isort           isortInt
+#define printArray      isortIntPrintArray
+#include "../insertion-sort/isort-int.c"
+#undef main
+#undef isort
+#undef printArray
+
+#define main            isortGenMain
+#define isort           isortGen
+#define compareInt      isortCompareInt
+#define compareFloat    isortCompareFloat
+#define compareChar     isortCompareChar
+#define printIntArray   isortPrintIntArray
+#define printFloatArray isortPrintFloatArray
+#define printCharArray  isortPrintCharArray
+#define resetSortStats  isortResetSortStats
+#define printSortStats  isortPrintSortStats
+#include "../insertion-sort/isort-gen.c"
+#undef CMP
+#undef COPY
+#undef MOVE
+#undef STAT_ALLOC
+#undef resetSortStats
+#undef printSortStats
+#undef main
+#undef isort
+#undef compareInt
+#undef compareFloat
+#undef compareChar
+#undef printIntArray
+#undef printFloatArray
+#undef printCharArray
+
+#define main            msortIntMain
+#define merge           msortIntMerge
+#define msort           msortIntMsort
+#define mergeSort       msortIntMergeSort
+#define printIntArray   msortIntPrintIntArray
+#define allocScratch    msortIntAllocScratch
+#define freeScratch     msortIntFreeScratch
+#define gallopRight     msortIntGallopRight
+#define gallopLeft      msortIntGallopLeft
+#include "../mergesort/msort-int.c"
+#undef main
+#undef merge
+#undef msort
+#undef mergeSort
+#undef printIntArray
+#undef allocScratch
+#undef freeScratch
+#undef gallopRight
+#undef gallopLeft
+
+#define main            msortGenMain
+#include "../mergesort/msort-gen.c"
+#undef main
+
+#define main            msortTmplMain
+#define printIntArray   msortTmplPrintIntArray
+#define printFloatArray msortTmplPrintFloatArray
+#define printCharArray  msortTmplPrintCharArray
+#define elapsed         msortTmplElapsed
+#define compareIntQsort msortTmplCompareIntQsort
+#include "../mergesort/msort-tmpl.c"
+#undef main
+#undef printIntArray
+#undef printFloatArray
+#undef printCharArray
+#undef elapsed
+#undef compareIntQsort
+
+#define main            msortSimdMain
+#define printIntArray   msortSimdPrintIntArray
+#define printFloatArray msortSimdPrintFloatArray
+#include "../mergesort/msort-simd.c"
+#undef main
+#undef printIntArray
+#undef printFloatArray
+
+#define main            rsortMain
+#define printIntArray   rsortPrintIntArray
+#define printFloatArray rsortPrintFloatArray
+#define printCharArray  rsortPrintCharArray
+#include "../radix-sort/rsort.c"
+#undef main
+#undef printIntArray
+#undef printFloatArray
+#undef printCharArray
+
+/*
+ *  Declarations
+ */
+
+typedef void (*bench_fun)(int* array, size_t n);
+
+/* A sort entry point under test */
+typedef struct BenchSort
+{
+    const char* name;
+    bench_fun   sort;
+    size_t      maxSize;   // larger inputs are skipped
+} BenchSort;
+
+typedef void (*gen_fun)(int* array, size_t n);
+
+/* An input distribution */
+typedef struct BenchDist
+{
+    const char* name;
+    gen_fun     generate;
+} BenchDist;
+
+/* Output formats */
+typedef enum BenchFormat { FORMAT_TABLE, FORMAT_CSV, FORMAT_JSON } BenchFormat;
+
+/* Wrappers, giving every sort the same signature */
+void benchIsortInt(int* array, size_t n);
+void benchIsortGen(int* array, size_t n);
+void benchMsortInt(int* array, size_t n);
+void benchMergeSort(int* array, size_t n);
+void benchMergeSortBottomUp(int* array, size_t n);
+void benchMergeSortAdaptive(int* array, size_t n);
+void benchMergeSortInPlace(int* array, size_t n);
+void benchParallelMergeSort(int* array, size_t n);
+void benchMergeSortIndirect(int* array, size_t n);
+void benchMergeSortPrefix(int* array, size_t n);
+uint64_t intPrefix(void* t);
+void benchMergeSortTmpl(int* array, size_t n);
+void benchMergeSortSimd(int* array, size_t n);
+void benchRadixSort(int* array, size_t n);
+
+/* Input generators */
+uint64_t nextRandom(void);
+void genRandom(int* array, size_t n);
+void genSorted(int* array, size_t n);
+void genReverse(int* array, size_t n);
+void genFewUnique(int* array, size_t n);
+void genOrganPipe(int* array, size_t n);
+void genZipf(int* array, size_t n);
+
+// check that array[0..n) is sorted
+int isSorted(int* array, size_t n);
+
+double now(void);
+
+const BenchSort sorts[] =
+{
+    { "isort-int",                 benchIsortInt,          1 << 16 },
+    { "isort-gen",                 benchIsortGen,          1 << 16 },
+    { "msort-int",                 benchMsortInt,          SIZE_MAX },
+    { "mergeSort",                 benchMergeSort,         SIZE_MAX },
+    { "mergeSortBottomUp",         benchMergeSortBottomUp, SIZE_MAX },
+    { "mergeSortAdaptive",         benchMergeSortAdaptive, SIZE_MAX },
+    { "mergeSortInPlace",          benchMergeSortInPlace,  SIZE_MAX },
+    { "parallelMergeSort",         benchParallelMergeSort, SIZE_MAX },
+    { "mergeSortIndirect",         benchMergeSortIndirect, SIZE_MAX },
+    { "mergeSortPrefix",           benchMergeSortPrefix,   SIZE_MAX },
+    { "mergeSort_int",             benchMergeSortTmpl,     SIZE_MAX },
+    { "mergeSortInt-simd",         benchMergeSortSimd,     SIZE_MAX },
+    { "radixSortInt",              benchRadixSort,         SIZE_MAX },
+};
+
+const BenchDist dists[] =
+{
+    { "random",     genRandom    },
+    { "sorted",     genSorted    },
+    { "reverse",    genReverse   },
+    { "few-unique", genFewUnique },
+    { "organ-pipe", genOrganPipe },
+    { "zipf",       genZipf      },
+};
+
+int main(int argc, char* argv[])
+{
+    size_t minSize = 1000, maxSize = 1000000;
+    int reps = 5, opt;
+    const char* sortFilter = "";
+    const char* distFilter = "";
+    BenchFormat format = FORMAT_TABLE;
+
+    while ((opt = getopt(argc, argv, "n:N:r:s:d:f:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': minSize = strtoull(optarg, NULL, 10); break;
+            case 'N': maxSize = strtoull(optarg, NULL, 10); break;
+            case 'r': reps = atoi(optarg);                  break;
+            case 's': sortFilter = optarg;                  break;
+            case 'd': distFilter = optarg;                  break;
+            case 'f':
+                format = strcmp(optarg, "csv") == 0  ? FORMAT_CSV  :
+                         strcmp(optarg, "json") == 0 ? FORMAT_JSON : FORMAT_TABLE;
+                break;
+            default:
+                fprintf(stderr, "sortbench : Usage is 'sortbench [-n min-size] [-N max-size] "
+                                "[-r repetitions] [-s sort] [-d distribution] [-f table|csv|json]'\n");
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (minSize == 0 || maxSize < minSize || reps < 1)
+    {
+        fprintf(stderr, "[ERROR] Invalid sizes or repetitions\n");
+        return EXIT_FAILURE;
+    }
+
+    int* input = (int* )malloc(maxSize * sizeof(int));
+    int* array = (int* )malloc(maxSize * sizeof(int));
+    double* times = (double* )malloc(reps * sizeof(double));
+    if (!input || !array || !times)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return EXIT_FAILURE;
+    }
+
+    if (format == FORMAT_TABLE)
+        printf("%-20s %-11s %12s %12s %12s %8s\n",
+               "sort", "input", "size", "ns/elem", "Melem/s", "rsd%");
+    else if (format == FORMAT_CSV)
+        printf("sort,input,size,reps,mean_s,stddev_s,ns_per_elem,melem_per_s\n");
+    else
+        printf("[\n");
+
+    int first = 1, failed = 0;
+
+    for (size_t n = minSize; n <= maxSize; n = n > SIZE_MAX / 10 ? maxSize + 1 : n * 10)
+    {
+        for (size_t d = 0; d < sizeof(dists) / sizeof(dists[0]); d++)
+        {
+            if (!strstr(dists[d].name, distFilter))
+                continue;
+
+            dists[d].generate(input, n);
+
+            for (size_t s = 0; s < sizeof(sorts) / sizeof(sorts[0]); s++)
+            {
+                if (!strstr(sorts[s].name, sortFilter) || n > sorts[s].maxSize)
+                    continue;
+
+                double mean = 0, var = 0;
+
+                for (int r = 0; r < reps; r++)
+                {
+                    memcpy(array, input, n * sizeof(int));
+
+                    double start = now();
+                    sorts[s].sort(array, n);
+                    times[r] = now() - start;
+                    mean += times[r];
+
+                    if (!isSorted(array, n))
+                    {
+                        fprintf(stderr, "[ERROR] %s failed on %s input of size %zu\n",
+                                sorts[s].name, dists[d].name, n);
+                        failed = 1;
+                    }
+                }
+
+                mean /= reps;
+                for (int r = 0; r < reps; r++)
+                    var += (times[r] - mean) * (times[r] - mean);
+                double sd = reps > 1 ? sqrt(var / (reps - 1)) : 0;
+                double nsPerElem = mean / n * 1e9;
+                double mps = n / mean / 1e6;
+
+                if (format == FORMAT_TABLE)
+                    printf("%-20s %-11s %12zu %12.2f %12.2f %8.2f\n", sorts[s].name,
+                           dists[d].name, n, nsPerElem, mps, mean > 0 ? 100 * sd / mean : 0);
+                else if (format == FORMAT_CSV)
+                    printf("%s,%s,%zu,%d,%.9f,%.9f,%.4f,%.4f\n", sorts[s].name,
+                           dists[d].name, n, reps, mean, sd, nsPerElem, mps);
+                else
+                {
+                    printf("%s  { \"sort\": \"%s\", \"input\": \"%s\", \"size\": %zu, \"reps\": %d, "
+                           "\"mean_s\": %.9f, \"stddev_s\": %.9f, \"ns_per_elem\": %.4f, "
+                           "\"melem_per_s\": %.4f }", first ? "" : ",\n", sorts[s].name,
+                           dists[d].name, n, reps, mean, sd, nsPerElem, mps);
+                    first = 0;
+                }
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (format == FORMAT_JSON)
+        printf("\n]\n");
+
+    free(input);
+    free(array);
+    free(times);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ *  Definitions
+ */
+
+/* Wrappers */
+
+void benchIsortInt(int* array, size_t n)
+{
+    isortInt(array, n);
+}
+
+void benchIsortGen(int* array, size_t n)
+{
+    isortGen(array, n, sizeof(int), isortCompareInt);
+}
+
+void benchMsortInt(int* array, size_t n)
+{
+    msortIntMergeSort(array, 0, n - 1);
+}
+
+void benchMergeSort(int* array, size_t n)
+{
+    mergeSort(array, 0, n - 1, sizeof(int), compareInt);
+}
+
+void benchMergeSortBottomUp(int* array, size_t n)
+{
+    mergeSortBottomUp(array, 0, n - 1, sizeof(int), compareInt, 0);
+}
+
+void benchMergeSortAdaptive(int* array, size_t n)
+{
+    mergeSortAdaptive(array, 0, n - 1, sizeof(int), compareInt);
+}
+
+void benchMergeSortInPlace(int* array, size_t n)
+{
+    mergeSortInPlace(array, 0, n - 1, sizeof(int), compareInt);
+}
+
+void benchParallelMergeSort(int* array, size_t n)
+{
+    parallelMergeSort(array, 0, n - 1, sizeof(int), compareInt, 0, 0);
+}
+
+void benchMergeSortIndirect(int* array, size_t n)
+{
+    mergeSortIndirect(array, 0, n - 1, sizeof(int), compareInt, 0, 0);
+}
+
+// the whole int is its own prefix, with the sign bit flipped
+uint64_t intPrefix(void* t)
+{
+    return (uint32_t)*(int*)t ^ 0x80000000u;
+}
+
+void benchMergeSortPrefix(int* array, size_t n)
+{
+    mergeSortPrefix(array, 0, n - 1, sizeof(int), compareInt, intPrefix);
+}
+
+void benchMergeSortTmpl(int* array, size_t n)
+{
+    mergeSort_int(array, 0, n - 1);
+}
+
+void benchMergeSortSimd(int* array, size_t n)
+{
+    mergeSortInt(array, 0, n - 1);
+}
+
+void benchRadixSort(int* array, size_t n)
+{
+    radixSortInt(array, n);
+}
+
+/* Generators */
+
+uint64_t nextRandom(void)
+{
+    // xorshift64*, fast and good enough for test inputs
+    static uint64_t state = 0x9E3779B97F4A7C15ull;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+
+void genRandom(int* array, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        array[i] = (int)(nextRandom() >> 32);
+}
+
+void genSorted(int* array, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        array[i] = (int)(i - n / 2);
+}
+
+void genReverse(int* array, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        array[i] = (int)(n / 2 - i);
+}
+
+void genFewUnique(int* array, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        array[i] = (int)(nextRandom() % 16);
+}
+
+void genOrganPipe(int* array, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        array[i] = (int)(i < n / 2 ? i : n - i);
+}
+
+void genZipf(int* array, size_t n)
+{
+    // Zipf (s = 1) over up to 2^20 values, sampled by binary
+    // search over the cumulative distribution
+    size_t k = n < (1 << 20) ? n : (1 << 20), i;
+    double* cdf = (double* )malloc(k * sizeof(double));
+    if (!cdf)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        genRandom(array, n);
+        return;
+    }
+
+    double sum = 0;
+    for (i = 0; i < k; i++)
+        cdf[i] = sum += 1.0 / (i + 1);
+
+    for (i = 0; i < n; i++)
+    {
+        double u = (nextRandom() >> 11) * (1.0 / 9007199254740992.0) * sum;
+        size_t lo = 0, hi = k - 1;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (cdf[mid] < u)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        // scatter the ranks so that frequent values are not small
+        array[i] = (int)((lo * 2654435761u) & 0x7FFFFFFF);
+    }
+
+    free(cdf);
+}
+
+int isSorted(int* array, size_t n)
+{
+    for (size_t i = 1; i < n; i++)
+        if (array[i - 1] > array[i])
+            return 0;
+    return 1;
+}
+
+double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
@@ -0,0 +1,720 @@
+/*
+ *  External merge sort
+ *  ===================
+ *
+ *  Sorts a binary file of fixed-size records that does not fit in
+ *  memory, using at most a given amount of memory :-
+ *
+ *   1. Run generation : the input is read a memory load at a time,
+ *      each load is sorted with mergeSortScratch() (half the budget
+ *      holds the records, the other half is its scratch buffer) and
+ *      written out to a temporary run file.
+ *   2. Merges         : up to `fanIn` runs at a time are merged with
+ *      a binary heap into a longer run, each run being read through
+ *      its own large buffer. Every run is an open file, so `fanIn` is
+ *      capped at EXTSORT_MAX_FANIN and below the process' limit on
+ *      open files, and once `fanIn` runs are open run generation
+ *      stops to merge the latest runs of the lowest level (a level
+ *      being the no. of merges behind a run) into one. The fewer than
+ *      `fanIn` runs left at the end are merged into the output file.
+ *
+ *  Ties between runs are broken by run number, so the sort is stable.
+ *  Temporary files are unlinked as soon as they are created, so they
+ *  disappear even if the program is killed.
+ *
+ *  Usage :-
+ *
+ *   extsort [-r record-size] [-m memory-MB] [-t tmp-dir] [-k int|float|bytes]
+ *           input output
+ *
+ *  Records are ordered by a leading int or float key, or by all
+ *  their bytes. Without arguments a self-test is run.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // for memcpy()
+#include <unistd.h> // for getopt(), mkstemp(), unlink()
+#include <sys/stat.h>
+#include <sys/resource.h> // for getrlimit()
+
+#define EXTSORT_MAX_PASSES  64
+
+// no merge input buffer gets less than this many bytes,
+// which bounds the fan-in of a merge pass
+#define EXTSORT_MIN_BUFFER  (64 * 1024)
+
+// most runs merged at once, and so open at once
+#define EXTSORT_MAX_FANIN   256
+
+// files kept out of the fan-in : stdin, stdout, stderr,
+// the input, the output of a merge, and some slack
+#define EXTSORT_RESERVED_FDS 8
+
+/*
+ *  Declarations
+ */
+
+typedef signed char (*compare_fun)(void*, void*);
+
+/* I/O statistics of one pass over the data */
+typedef struct ExtSortPass
+{
+    unsigned long long bytesRead;
+    unsigned long long bytesWritten;
+    size_t             runsIn;   // runs read (0 for run generation)
+    size_t             runsOut;  // runs written
+} ExtSortPass;
+
+/* I/O statistics of a whole sort; run generation counts as pass 0,
+   and pass n gathers the merges whose output runs are n merges deep,
+   whether they were made during run generation or at the end */
+typedef struct ExtSortStats
+{
+    size_t      passes;
+    ExtSortPass pass[EXTSORT_MAX_PASSES];
+} ExtSortStats;
+
+// to be called by the user
+//  => recordSize   - size of each record in bytes
+//  => memoryBudget - bytes of memory the sort may use for records
+//  => tmpDir       - directory for the run files, NULL means /tmp
+//  => stats        - filled with per-pass I/O statistics, may be NULL
+// returns 0 on success, -1 on error
+int externalSort(const char* input         ,
+                 const char* output        ,
+                 size_t recordSize         ,
+                 size_t memoryBudget       ,
+                 const char* tmpDir        ,
+                 compare_fun compare       ,
+                 ExtSortStats* stats       );
+
+// print the statistics of a sort
+void printStats(ExtSortStats* stats);
+
+/* In-memory merge sort, as in msort-gen.c */
+void mergeSortScratch(void* array, size_t low, size_t high, size_t dataSize,
+                      compare_fun compare, void* scratch);
+void msortInto(void* src, void* dst, size_t n, size_t dataSize, compare_fun compare);
+void mergeRuns(void* a, size_t na, void* b, size_t nb, void* out,
+               size_t dataSize, compare_fun compare);
+
+/* Buffered run reader */
+typedef struct RunReader
+{
+    FILE*  f;
+    char*  buf;
+    size_t cap;      // buffer capacity in records
+    size_t len;      // records in the buffer
+    size_t pos;      // next record in the buffer
+} RunReader;
+
+/* Buffered run writer */
+typedef struct RunWriter
+{
+    FILE*  f;
+    char*  buf;
+    size_t cap;      // buffer capacity in records
+    size_t len;      // records in the buffer
+} RunWriter;
+
+// create an anonymous temporary file in dir
+FILE* createTempFile(const char* dir);
+
+// refill a reader, returns the no. of records now available
+size_t fillReader(RunReader* r, size_t recordSize, ExtSortPass* pass);
+
+// append a record to a writer, flushing its buffer when full
+int writeRecord(RunWriter* w, void* record, size_t recordSize, ExtSortPass* pass);
+int flushWriter(RunWriter* w, size_t recordSize, ExtSortPass* pass);
+
+// merge runs[0..k) into out
+int mergeGroup(FILE** runs, size_t k, FILE* out, size_t recordSize, size_t memoryBudget,
+               compare_fun compare, ExtSortPass* pass);
+
+// no. of runs to merge at once for a budget, within the open file limit
+size_t mergeFanIn(size_t memoryBudget);
+
+// merge runs[first..*nRuns) into one new run, which replaces them
+int collapseRuns(FILE** runs, size_t* nRuns, size_t first, size_t recordSize,
+                 size_t memoryBudget, const char* tmpDir, compare_fun compare,
+                 ExtSortPass* pass);
+
+/* Comparators for records with a leading key */
+signed char compareInt(void* t1, void* t2);
+signed char compareFloat(void* t1, void* t2);
+
+// the record size used by compareBytes()
+size_t bytesRecordSize = 0;
+signed char compareBytes(void* t1, void* t2);
+
+// sort a generated file and check the result
+int selfTest(void);
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+        return selfTest() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    size_t recordSize = sizeof(int), memoryMB = 256;
+    const char* tmpDir = NULL;
+    compare_fun compare = compareInt;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:m:t:k:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': recordSize = strtoull(optarg, NULL, 10); break;
+            case 'm': memoryMB = strtoull(optarg, NULL, 10);   break;
+            case 't': tmpDir = optarg;                         break;
+            case 'k':
+                if (strcmp(optarg, "int") == 0)
+                    compare = compareInt;
+                else if (strcmp(optarg, "float") == 0)
+                    compare = compareFloat;
+                else if (strcmp(optarg, "bytes") == 0)
+                    compare = compareBytes;
+                else
+                {
+                    fprintf(stderr, "[ERROR] Unknown key type '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                fprintf(stderr, "extsort : Usage is 'extsort [-r record-size] [-m memory-MB] "
+                                "[-t tmp-dir] [-k int|float|bytes] input output'\n");
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind != 2 || recordSize == 0 || memoryMB == 0 ||
+        (compare != compareBytes && recordSize < 4))
+    {
+        fprintf(stderr, "extsort : Usage is 'extsort [-r record-size] [-m memory-MB] "
+                        "[-t tmp-dir] [-k int|float|bytes] input output'\n");
+        return EXIT_FAILURE;
+    }
+
+    bytesRecordSize = recordSize;
+
+    ExtSortStats stats;
+    if (externalSort(argv[optind], argv[optind + 1], recordSize, memoryMB << 20,
+                     tmpDir, compare, &stats) != 0)
+        return EXIT_FAILURE;
+
+    printStats(&stats);
+    return EXIT_SUCCESS;
+}
+
+/*
+ *  Definitions
+ */
+
+FILE* createTempFile(const char* dir)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/extsort-XXXXXX", dir ? dir : "/tmp");
+
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        fprintf(stderr, "[ERROR] Cannot create temporary file in %s\n", dir ? dir : "/tmp");
+        return NULL;
+    }
+    unlink(path);
+
+    FILE* f = fdopen(fd, "w+b");
+    if (!f)
+        close(fd);
+    return f;
+}
+
+size_t fillReader(RunReader* r, size_t recordSize, ExtSortPass* pass)
+{
+    if (r->pos < r->len)
+        return r->len - r->pos;
+
+    r->len = fread(r->buf, recordSize, r->cap, r->f);
+    r->pos = 0;
+    pass->bytesRead += (unsigned long long)r->len * recordSize;
+    return r->len;
+}
+
+int flushWriter(RunWriter* w, size_t recordSize, ExtSortPass* pass)
+{
+    if (w->len && fwrite(w->buf, recordSize, w->len, w->f) != w->len)
+    {
+        fprintf(stderr, "[ERROR] Write error\n");
+        return -1;
+    }
+    pass->bytesWritten += (unsigned long long)w->len * recordSize;
+    w->len = 0;
+    return 0;
+}
+
+int writeRecord(RunWriter* w, void* record, size_t recordSize, ExtSortPass* pass)
+{
+    memcpy(w->buf + w->len * recordSize, record, recordSize);
+    if (++w->len == w->cap)
+        return flushWriter(w, recordSize, pass);
+    return 0;
+}
+
+int mergeGroup(FILE** runs, size_t k, FILE* out, size_t recordSize, size_t memoryBudget,
+               compare_fun compare, ExtSortPass* pass)
+{
+    // the budget is split evenly between the k inputs and the output
+    size_t cap = memoryBudget / (k + 1) / recordSize;
+    if (cap == 0)
+        cap = 1;
+
+    RunReader* readers = (RunReader* )calloc(k, sizeof(RunReader));
+    size_t* heap = (size_t* )malloc(k * sizeof(size_t));
+    RunWriter w = { out, (char* )malloc(cap * recordSize), cap, 0 };
+    size_t i, n = 0;
+    int status = -1;
+
+    if (!readers || !heap || !w.buf)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        goto done;
+    }
+
+    for (i = 0; i < k; i++)
+    {
+        readers[i].f = runs[i];
+        readers[i].cap = cap;
+        readers[i].buf = (char* )malloc(cap * recordSize);
+        if (!readers[i].buf)
+        {
+            fprintf(stderr, "[ERROR] Memory error\n");
+            goto done;
+        }
+        rewind(runs[i]);
+    }
+
+// head record of the run at heap position h
+#define HEAD(h) (readers[heap[h]].buf + readers[heap[h]].pos * recordSize)
+// heap order: smaller head first, ties go to the earlier run
+#define BEFORE(x, y) ({ signed char cmp_ = compare(HEAD(x), HEAD(y)); \
+                        cmp_ < 0 || (cmp_ == 0 && heap[x] < heap[y]); })
+
+    // build a min-heap of the runs that are not empty
+    for (i = 0; i < k; i++)
+    {
+        if (fillReader(&readers[i], recordSize, pass) == 0)
+            continue;
+
+        size_t c = n++;
+        heap[c] = i;
+        while (c > 0 && BEFORE(c, (c - 1) / 2))
+        {
+            size_t p = (c - 1) / 2, t = heap[c];
+            heap[c] = heap[p];
+            heap[p] = t;
+            c = p;
+        }
+    }
+
+    while (n > 0)
+    {
+        RunReader* r = &readers[heap[0]];
+
+        if (writeRecord(&w, r->buf + r->pos * recordSize, recordSize, pass) != 0)
+            goto done;
+
+        // advance the winning run, dropping it once exhausted
+        r->pos++;
+        if (fillReader(r, recordSize, pass) == 0)
+            heap[0] = heap[--n];
+
+        // sift the new head down
+        size_t c = 0;
+        for (;;)
+        {
+            size_t l = 2 * c + 1, m = c;
+            if (l < n && BEFORE(l, m))
+                m = l;
+            if (l + 1 < n && BEFORE(l + 1, m))
+                m = l + 1;
+            if (m == c)
+                break;
+            size_t t = heap[c];
+            heap[c] = heap[m];
+            heap[m] = t;
+            c = m;
+        }
+    }
+
+#undef BEFORE
+#undef HEAD
+
+    status = flushWriter(&w, recordSize, pass);
+
+done:
+    if (readers)
+        for (i = 0; i < k; i++)
+            free(readers[i].buf);
+    free(readers);
+    free(heap);
+    free(w.buf);
+    return status;
+}
+
+size_t mergeFanIn(size_t memoryBudget)
+{
+    size_t fanIn = memoryBudget / EXTSORT_MIN_BUFFER - 1;
+    if (fanIn > EXTSORT_MAX_FANIN)
+        fanIn = EXTSORT_MAX_FANIN;
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY &&
+        fanIn > rl.rlim_cur - EXTSORT_RESERVED_FDS)
+        fanIn = rl.rlim_cur > EXTSORT_RESERVED_FDS ? rl.rlim_cur - EXTSORT_RESERVED_FDS : 0;
+
+    return fanIn < 2 ? 2 : fanIn;
+}
+
+int collapseRuns(FILE** runs, size_t* nRuns, size_t first, size_t recordSize,
+                 size_t memoryBudget, const char* tmpDir, compare_fun compare,
+                 ExtSortPass* pass)
+{
+    FILE* out = createTempFile(tmpDir);
+    if (!out)
+        return -1;
+
+    int failed = mergeGroup(runs + first, *nRuns - first, out, recordSize, memoryBudget,
+                            compare, pass);
+    for (size_t j = first; j < *nRuns; j++)
+        fclose(runs[j]);
+
+    pass->runsIn += *nRuns - first;
+    pass->runsOut++;
+
+    runs[first] = out;
+    *nRuns = first + 1;
+    return failed;
+}
+
+int externalSort(const char* input, const char* output, size_t recordSize,
+                 size_t memoryBudget, const char* tmpDir, compare_fun compare,
+                 ExtSortStats* stats)
+{
+    ExtSortStats localStats;
+    if (!stats)
+        stats = &localStats;
+    memset(stats, 0, sizeof(*stats));
+
+    FILE* in = fopen(input, "rb");
+    if (!in)
+    {
+        fprintf(stderr, "[ERROR] Cannot open %s\n", input);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fileno(in), &st) != 0 || st.st_size % recordSize != 0)
+    {
+        fprintf(stderr, "[ERROR] Size of %s is not a multiple of %zu\n", input, recordSize);
+        fclose(in);
+        return -1;
+    }
+
+    // half the budget for the records, half for the scratch buffer
+    size_t loadRecords = memoryBudget / 2 / recordSize;
+    if (loadRecords == 0)
+        loadRecords = 1;
+
+    char* load = (char* )malloc(loadRecords * recordSize);
+    char* scratch = (char* )malloc(loadRecords * recordSize);
+    FILE** runs = NULL;
+    unsigned* levels = NULL; // merges behind each run, never going up along runs[]
+    size_t nRuns = 0, maxRuns = 0, i;
+    size_t fanIn = mergeFanIn(memoryBudget);
+    int status = -1;
+
+    if (!load || !scratch)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        goto done;
+    }
+
+    // Step 1 : generate sorted runs
+    ExtSortPass* pass = &stats->pass[stats->passes++];
+    size_t got;
+
+    while ((got = fread(load, recordSize, loadRecords, in)) > 0)
+    {
+        pass->bytesRead += (unsigned long long)got * recordSize;
+        mergeSortScratch(load, 0, got - 1, recordSize, compare, scratch);
+
+        if (nRuns == maxRuns)
+        {
+            maxRuns = maxRuns ? 2 * maxRuns : 16;
+            FILE** grown = (FILE** )realloc(runs, maxRuns * sizeof(FILE*));
+            if (grown)
+                runs = grown;
+            unsigned* grownLevels = (unsigned* )realloc(levels, maxRuns * sizeof(unsigned));
+            if (grownLevels)
+                levels = grownLevels;
+            if (!grown || !grownLevels)
+            {
+                fprintf(stderr, "[ERROR] Memory error\n");
+                goto done;
+            }
+        }
+
+        if (!(runs[nRuns] = createTempFile(tmpDir)))
+            goto done;
+        levels[nRuns++] = 0;
+
+        if (fwrite(load, recordSize, got, runs[nRuns - 1]) != got)
+        {
+            fprintf(stderr, "[ERROR] Write error\n");
+            goto done;
+        }
+        pass->bytesWritten += (unsigned long long)got * recordSize;
+        pass->runsOut++;
+
+        if (nRuns < fanIn)
+            continue;
+
+        // all the runs we may open are open : merge the runs from the
+        // lowest level that has two or more, which are at the end of
+        // runs[] along with the single runs of any lower level
+        size_t first = nRuns - 1;
+        while (first > 0 && levels[first - 1] != levels[first])
+            first--;
+        while (first > 0 && levels[first - 1] == levels[first])
+            first--;
+
+        // merges to the same level count as one pass over the data
+        unsigned level = levels[first] + 1;
+        if (level >= EXTSORT_MAX_PASSES)
+        {
+            fprintf(stderr, "[ERROR] Too many merge passes\n");
+            goto done;
+        }
+        if (stats->passes <= level)
+            stats->passes = level + 1;
+
+        // the merge gets the whole budget, the load is read back later
+        free(load);
+        free(scratch);
+        load = scratch = NULL;
+
+        if (collapseRuns(runs, &nRuns, first, recordSize, memoryBudget, tmpDir, compare,
+                         &stats->pass[level]) != 0)
+            goto done;
+        levels[first] = level;
+
+        load = (char* )malloc(loadRecords * recordSize);
+        scratch = (char* )malloc(loadRecords * recordSize);
+        if (!load || !scratch)
+        {
+            fprintf(stderr, "[ERROR] Memory error\n");
+            goto done;
+        }
+    }
+
+    // the merge buffers reuse the memory of the run generation
+    free(load);
+    free(scratch);
+    load = scratch = NULL;
+
+    // Step 2 : fewer than fanIn runs are left, merge them into the output
+    FILE* out = fopen(output, "wb");
+    if (!out)
+    {
+        fprintf(stderr, "[ERROR] Cannot open %s\n", output);
+        goto done;
+    }
+
+    // one level above the highest run, which is the first one
+    unsigned level = nRuns ? levels[0] + 1 : 1;
+    if (level >= EXTSORT_MAX_PASSES)
+    {
+        fprintf(stderr, "[ERROR] Too many merge passes\n");
+        fclose(out);
+        goto done;
+    }
+    stats->passes = level + 1;
+
+    pass = &stats->pass[level];
+    pass->runsIn += nRuns;
+    pass->runsOut++;
+    status = mergeGroup(runs, nRuns, out, recordSize, memoryBudget, compare, pass);
+
+    if (fclose(out) != 0)
+        status = -1;
+
+done:
+    for (i = 0; i < nRuns; i++)
+        fclose(runs[i]);
+    free(runs);
+    free(levels);
+    free(load);
+    free(scratch);
+    fclose(in);
+    return status;
+}
+
+void printStats(ExtSortStats* stats)
+{
+    for (size_t p = 0; p < stats->passes; p++)
+    {
+        ExtSortPass* pass = &stats->pass[p];
+
+        if (p == 0)
+            printf("Pass %zu (runs)  : ", p);
+        else
+            printf("Pass %zu (merge) : ", p);
+
+        printf("%llu bytes read, %llu bytes written, %zu -> %zu runs\n",
+               pass->bytesRead, pass->bytesWritten, pass->runsIn, pass->runsOut);
+    }
+}
+
+/* In-memory merge sort */
+
+void mergeRuns(void* a, size_t na, void* b, size_t nb, void* out,
+               size_t dataSize, compare_fun compare)
+{
+    size_t i = 0, j = 0, k = 0;
+
+    // ties are taken from the left run to keep the sort stable
+    while (i < na && j < nb)
+    {
+        if (compare(b + j * dataSize, a + i * dataSize) < 0)
+            memcpy(out + k++ * dataSize, b + j++ * dataSize, dataSize);
+        else
+            memcpy(out + k++ * dataSize, a + i++ * dataSize, dataSize);
+    }
+
+    if (i < na)
+        memcpy(out + k * dataSize, a + i * dataSize, (na - i) * dataSize);
+    else if (j < nb)
+        memcpy(out + k * dataSize, b + j * dataSize, (nb - j) * dataSize);
+}
+
+void msortInto(void* src, void* dst, size_t n, size_t dataSize, compare_fun compare)
+{
+    if (n < 2)
+        return;
+
+    size_t half = n / 2;
+
+    msortInto(dst, src, half, dataSize, compare);
+    msortInto(dst + half * dataSize, src + half * dataSize, n - half, dataSize, compare);
+    mergeRuns(src, half, src + half * dataSize, n - half, dst, dataSize, compare);
+}
+
+void mergeSortScratch(void* array, size_t low, size_t high, size_t dataSize,
+                      compare_fun compare, void* scratch)
+{
+    if (low >= high)
+        return;
+
+    size_t n = high - low + 1;
+
+    memcpy(scratch, array + low * dataSize, n * dataSize);
+    msortInto(scratch, array + low * dataSize, n, dataSize, compare);
+}
+
+/* Comparators */
+
+signed char compareInt(void* t1, void* t2)
+{
+    int _t1, _t2;
+    memcpy(&_t1, t1, sizeof(int));
+    memcpy(&_t2, t2, sizeof(int));
+
+    if (_t1 < _t2)
+        return -1;
+    else if (_t1 > _t2)
+        return 1;
+    else
+        return 0;
+}
+
+signed char compareFloat(void* t1, void* t2)
+{
+    float _t1, _t2;
+    memcpy(&_t1, t1, sizeof(float));
+    memcpy(&_t2, t2, sizeof(float));
+
+    if (_t1 < _t2)
+        return -1;
+    else if (_t1 > _t2)
+        return 1;
+    else
+        return 0;
+}
+
+signed char compareBytes(void* t1, void* t2)
+{
+    int c = memcmp(t1, t2, bytesRecordSize);
+    return c < 0 ? -1 : c > 0;
+}
+
+/* Self test */
+
+int selfTest(void)
+{
+    // 16 byte records : an int key, followed by the record's
+    // original position and some padding
+    typedef struct Record
+    {
+        int      key;
+        unsigned id;
+        char     pad[8];
+    } Record;
+
+    size_t n = 1 << 20, i;
+    char input[] = "/tmp/extsort-in-XXXXXX";
+    char output[] = "/tmp/extsort-out-XXXXXX";
+    int fdIn = mkstemp(input), fdOut = mkstemp(output);
+    if (fdIn < 0 || fdOut < 0)
+    {
+        fprintf(stderr, "[ERROR] Cannot create test files\n");
+        return -1;
+    }
+    close(fdOut);
+
+    FILE* f = fdopen(fdIn, "wb");
+    srand(1);
+    for (i = 0; i < n; i++)
+    {
+        Record r = { rand() % 100000, (unsigned)i, { 0 } };
+        fwrite(&r, sizeof(r), 1, f);
+    }
+    fclose(f);
+
+    printf("Test : External mergesort of %zu records (%zu bytes) with a 1 MB budget :-\n",
+           n, n * sizeof(Record));
+
+    ExtSortStats stats;
+    int status = externalSort(input, output, sizeof(Record), 1 << 20, NULL, compareInt, &stats);
+    printStats(&stats);
+
+    // check the output is sorted, and stable
+    size_t count = 0, unordered = 0;
+    Record prev, cur;
+    f = fopen(output, "rb");
+    while (status == 0 && f && fread(&cur, sizeof(cur), 1, f) == 1)
+    {
+        if (count++ && (prev.key > cur.key || (prev.key == cur.key && prev.id > cur.id)))
+            unordered++;
+        prev = cur;
+    }
+    if (f)
+        fclose(f);
+
+    printf("%zu records, %zu out of order\n", count, unordered);
+
+    unlink(input);
+    unlink(output);
+    return status == 0 && count == n && unordered == 0 ? 0 : -1;
+}
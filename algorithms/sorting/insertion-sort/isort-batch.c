@@ -0,0 +1,359 @@
+/*
+ *    Batched insertion sort
+ *    ======================
+ *
+ *    Sorts a batch of many small int arrays, stored one after the
+ *    other in a flat buffer and delimited by a table of offsets, in
+ *    a single call.
+ *
+ *    With AVX2, arrays of up to BATCH_NET_MAX elements are sorted 8
+ *    at a time by a Batcher odd-even merge sorting network : element
+ *    e of each of the 8 arrays goes to lane l of register e, padded
+ *    with INT_MAX up to the network size, and every comparator of
+ *    the network is a vector min and max. Arrays that are too long
+ *    for the networks, and all arrays without AVX2, are insertion
+ *    sorted.
+ *
+ *    The batch can be split across threads, by no. of elements, so
+ *    compile with -pthread.
+ *
+ *    Requires GCC or Clang on x86 (target attributes and
+ *    __builtin_cpu_supports()).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h> // for sysconf()
+#include <immintrin.h>
+
+// largest array sorted by a network, a power of 2
+#define BATCH_NET_MAX    64
+
+// networks are built for sizes 2, 4, ..., BATCH_NET_MAX
+#define BATCH_NET_LEVELS 6
+
+// comparators in the largest network, (k^2 - k + 4) 2^(k - 2) - 1 for 2^k
+#define BATCH_NET_PAIRS  543
+
+// arrays sorted together by one network run
+#define BATCH_LANES      8
+
+/* A sorting network, as a list of comparators (i, j), i < j */
+typedef struct BatchNetwork
+{
+    size_t        len;
+    unsigned char pairs[BATCH_NET_PAIRS][2];
+} BatchNetwork;
+
+/* A contiguous part of the batch, one per thread */
+typedef struct BatchTask
+{
+    int*          keys;
+    const size_t* offsets;
+    size_t        first;  // first array of the part
+    size_t        last;   // one past its last array
+    int           useNet; // sort with the networks
+} BatchTask;
+
+// to be called by the user; sorts each of the count arrays
+// keys[offsets[i] .. offsets[i + 1]), offsets has count + 1 entries
+//  => threads - no. of threads to use, 0 means one per online CPU
+void isortBatchInt(int* keys, const size_t* offsets, size_t count, unsigned threads);
+
+// build the networks, once
+void buildNetworks(void);
+
+// sort the arrays of one part of the batch
+void* batchWorker(void* arg);
+
+// sort up to BATCH_LANES arrays, of at most BATCH_NET_MAX elements
+// each, with the network for `width` elements
+void sortLanesAvx2(int* keys, const size_t* start, const size_t* len, size_t lanes,
+                   size_t width);
+
+// insertion sort, for the arrays the networks can't take
+void isortInt(int* array, size_t n);
+
+/* Helpers */
+void printBatch(int* keys, const size_t* offsets, size_t count);
+double elapsed(struct timespec start);
+int compareIntQsort(const void* t1, const void* t2);
+
+BatchNetwork networks[BATCH_NET_LEVELS];
+pthread_once_t networksOnce = PTHREAD_ONCE_INIT;
+
+int main()
+{
+    int keys[] = { 5, 3, 9, 1,   7,   8, 2, 6, 4, 0, 3,   2, 1 };
+    size_t offsets[] = { 0, 4, 5, 11, 13 };
+    size_t count = 4;
+
+    printf("Test batched insertion sort (%s) :-\n\n",
+           __builtin_cpu_supports("avx2") ? "avx2 networks" : "scalar");
+    printBatch(keys, offsets, count);
+    isortBatchInt(keys, offsets, count, 1);
+    printBatch(keys, offsets, count);
+
+    // a million arrays of 8 to 64 elements
+    size_t bigCount = 1 << 20, i, j;
+    size_t* bigOffsets = (size_t* )malloc((bigCount + 1) * sizeof(size_t));
+
+    srand(1);
+    bigOffsets[0] = 0;
+    for (i = 0; i < bigCount; i++)
+        bigOffsets[i + 1] = bigOffsets[i] + 8 + rand() % 57;
+
+    size_t total = bigOffsets[bigCount];
+    int* input = (int* )malloc(total * sizeof(int));
+    int* big = (int* )malloc(total * sizeof(int));
+    for (i = 0; i < total; i++)
+        input[i] = rand() - RAND_MAX / 2;
+
+    printf("\nWith %zu arrays, %zu elements in all:-\n", bigCount, total);
+
+    for (int mode = 0; mode < 4; mode++)
+    {
+        unsigned threads = mode == 2 ? 1 : 0;
+        memcpy(big, input, total * sizeof(int));
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (mode == 0)
+            for (i = 0; i < bigCount; i++)
+                qsort(big + bigOffsets[i], bigOffsets[i + 1] - bigOffsets[i], sizeof(int),
+                      compareIntQsort);
+        else if (mode == 1)
+            for (i = 0; i < bigCount; i++)
+                isortInt(big + bigOffsets[i], bigOffsets[i + 1] - bigOffsets[i]);
+        else
+            isortBatchInt(big, bigOffsets, bigCount, threads);
+        double ms = elapsed(start);
+
+        size_t unordered = 0;
+        for (i = 0; i < bigCount; i++)
+            for (j = bigOffsets[i] + 1; j < bigOffsets[i + 1]; j++)
+                unordered += big[j - 1] > big[j];
+
+        const char* names[] = { "qsort per array    ", "isortInt per array ",
+                                "isortBatchInt, 1 thread", "isortBatchInt, all threads" };
+        printf("%-27s : %8.2f ms, %zu out of order\n", names[mode], ms, unordered);
+    }
+
+    free(bigOffsets);
+    free(input);
+    free(big);
+
+    return 0;
+}
+
+// implementation
+
+void isortBatchInt(int* keys, const size_t* offsets, size_t count, unsigned threads)
+{
+    int useNet = __builtin_cpu_supports("avx2");
+    if (useNet)
+        pthread_once(&networksOnce, buildNetworks);
+
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    if (threads > count)
+        threads = count ? (unsigned)count : 1;
+
+    BatchTask* tasks = (BatchTask* )malloc(threads * sizeof(BatchTask));
+    pthread_t* ids = (pthread_t* )malloc(threads * sizeof(pthread_t));
+    if (!tasks || !ids)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(tasks);
+        free(ids);
+        return;
+    }
+
+    // cut the batch where the offsets cross equal shares of elements
+    size_t total = offsets[count] - offsets[0], first = 0;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        size_t target = offsets[0] + total / threads * (t + 1), last = first;
+
+        if (t == threads - 1)
+            last = count;
+        else
+        {
+            size_t lo = first, hi = count;
+            while (lo < hi)
+            {
+                size_t mid = lo + (hi - lo) / 2;
+                if (offsets[mid] < target)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            last = lo;
+        }
+
+        tasks[t] = (BatchTask){ keys, offsets, first, last, useNet };
+        first = last;
+    }
+
+    unsigned started = 0;
+    for (unsigned t = 1; t < threads; t++, started++)
+        if (pthread_create(&ids[t], NULL, batchWorker, &tasks[t]))
+            break;
+
+    // the calling thread takes the first part, and any part whose
+    // thread could not be started
+    batchWorker(&tasks[0]);
+    for (unsigned t = started + 1; t < threads; t++)
+        batchWorker(&tasks[t]);
+
+    for (unsigned t = 1; t <= started; t++)
+        pthread_join(ids[t], NULL);
+
+    free(tasks);
+    free(ids);
+}
+
+void buildNetworks(void)
+{
+    // Batcher's odd-even merge sort, for n = 2, 4, ..., BATCH_NET_MAX
+    for (size_t level = 0; level < BATCH_NET_LEVELS; level++)
+    {
+        size_t n = (size_t)2 << level, len = 0, p, k, j, i;
+
+        for (p = 1; p < n; p *= 2)
+            for (k = p; k >= 1; k /= 2)
+                for (j = k % p; j + k < n; j += 2 * k)
+                    for (i = 0; i < k && i + j + k < n; i++)
+                        if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+                        {
+                            networks[level].pairs[len][0] = (unsigned char)(i + j);
+                            networks[level].pairs[len][1] = (unsigned char)(i + j + k);
+                            len++;
+                        }
+
+        networks[level].len = len;
+    }
+}
+
+void* batchWorker(void* arg)
+{
+    BatchTask* t = (BatchTask* )arg;
+    size_t start[BATCH_LANES], len[BATCH_LANES], lanes = 0, width = 2;
+
+    for (size_t i = t->first; i < t->last; i++)
+    {
+        size_t n = t->offsets[i + 1] - t->offsets[i];
+
+        if (n < 2)
+            continue;
+
+        if (!t->useNet || n > BATCH_NET_MAX)
+        {
+            isortInt(t->keys + t->offsets[i], n);
+            continue;
+        }
+
+        // gather arrays until the lanes are full; the network is the
+        // one for the longest of them
+        start[lanes] = t->offsets[i];
+        len[lanes++] = n;
+        while (width < n)
+            width *= 2;
+
+        if (lanes == BATCH_LANES)
+        {
+            sortLanesAvx2(t->keys, start, len, lanes, width);
+            lanes = 0;
+            width = 2;
+        }
+    }
+
+    if (lanes)
+        sortLanesAvx2(t->keys, start, len, lanes, width);
+
+    return NULL;
+}
+
+__attribute__((target("avx2")))
+void sortLanesAvx2(int* keys, const size_t* start, const size_t* len, size_t lanes,
+                   size_t width)
+{
+    _Alignas(32) int cols[BATCH_NET_MAX][BATCH_LANES];
+    __m256i v[BATCH_NET_MAX];
+    size_t e, l;
+
+    // transpose in, padding short arrays and unused lanes with INT_MAX
+    for (l = 0; l < BATCH_LANES; l++)
+        for (e = 0; e < width; e++)
+            cols[e][l] = l < lanes && e < len[l] ? keys[start[l] + e] : INT_MAX;
+
+    for (e = 0; e < width; e++)
+        v[e] = _mm256_load_si256((__m256i* )cols[e]);
+
+    const BatchNetwork* net = &networks[__builtin_ctzll(width) - 1];
+    for (size_t p = 0; p < net->len; p++)
+    {
+        __m256i a = v[net->pairs[p][0]], b = v[net->pairs[p][1]];
+        v[net->pairs[p][0]] = _mm256_min_epi32(a, b);
+        v[net->pairs[p][1]] = _mm256_max_epi32(a, b);
+    }
+
+    for (e = 0; e < width; e++)
+        _mm256_store_si256((__m256i* )cols[e], v[e]);
+
+    // transpose out; the padding sorted to the end of each lane
+    for (l = 0; l < lanes; l++)
+        for (e = 0; e < len[l]; e++)
+            keys[start[l] + e] = cols[e][l];
+}
+
+void isortInt(int* array, size_t n)
+{
+    for (size_t j = 1; j < n; j++)
+    {
+        int key = array[j];
+        size_t i = j;
+
+        while (i > 0 && array[i - 1] > key)
+        {
+            array[i] = array[i - 1];
+            i--;
+        }
+
+        array[i] = key;
+    }
+}
+
+void printBatch(int* keys, const size_t* offsets, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        printf("[ ");
+        for (size_t j = offsets[i]; j < offsets[i + 1]; j++)
+            printf("%d ", keys[j]);
+        printf("] ");
+    }
+    printf("\n");
+}
+
+double elapsed(struct timespec start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+int compareIntQsort(const void* t1, const void* t2)
+{
+    int _t1 = *(const int*)t1;
+    int _t2 = *(const int*)t2;
+
+    return (_t1 > _t2) - (_t1 < _t2);
+}
@@ -1,14 +1,59 @@
 /*
  *    Insertion Sort
+ *
+ *    Compiling with -DISORT_STATS fills isortStats with operation
+ *    counts as the sort runs; without it the counting compiles away.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// elements up to this size are inserted through a slot on the stack
+#define ISORT_STACK_SLOT 256
+
+// operation counters
+typedef struct ISortStats
+{
+    unsigned long long comparisons;  // calls to comp
+    unsigned long long moves;        // elements copied or moved
+    unsigned long long bytesCopied;  // bytes copied or moved
+    unsigned long long allocations;  // calls to malloc()
+    size_t             peakScratch;  // largest heap slot used
+} ISortStats;
+
+#ifdef ISORT_STATS
+
+ISortStats isortStats;
+
+void resetSortStats(void);
+void printSortStats(void);
+
+#define CMP(a, b)           (isortStats.comparisons++, comp(a, b))
+#define COPY(d, s, n, size) (isortStats.moves += (n), isortStats.bytesCopied += (n) * (size), \
+                             memcpy(d, s, (n) * (size)))
+#define MOVE(d, s, n, size) (isortStats.moves += (n), isortStats.bytesCopied += (n) * (size), \
+                             memmove(d, s, (n) * (size)))
+#define STAT_ALLOC(bytes)   (isortStats.allocations++, \
+                             isortStats.peakScratch = isortStats.peakScratch > (bytes) ? \
+                                                      isortStats.peakScratch : (bytes))
+
+#else
+
+#define CMP(a, b)           comp(a, b)
+#define COPY(d, s, n, size) memcpy(d, s, (n) * (size))
+#define MOVE(d, s, n, size) memmove(d, s, (n) * (size))
+#define STAT_ALLOC(bytes)
+
+#endif
+
 // generic insertion sort
 void isort(void* array, size_t num, size_t size, int (*comp)(void* a, void* b));
 
+// same as isort(), using `slot`, a caller-owned buffer of `size`
+// bytes, to hold the element being inserted
+void isortSlot(void* array, size_t num, size_t size, int (*comp)(void* a, void* b), void* slot);
+
 // compare and print function for int, float and char arrays
 int compareInt(void* t1, void* t2);
 int compareFloat(void* t1, void* t2);
@@ -32,6 +77,9 @@ int main(int argc, char* argv[])
     printIntArray(iarr, size);
     isort(iarr, size, sizeof(int), compareInt);
     printIntArray(iarr, size);
+#ifdef ISORT_STATS
+    printSortStats();
+#endif
 
     printf("\nWith floating point array:-\n");
     printFloatArray(farr, size);
@@ -48,32 +96,102 @@ int main(int argc, char* argv[])
 
 // implementation
 
-void isort(void* array, size_t num, size_t size, int (*comp)(void* a, void* b))
+// The insertion point is found by binary search over the sorted
+// prefix, and the greater elements are shifted with one memmove().
+// Inlined into isortSlot() once per small element size, so that
+// the copies of the key are done with constant sizes.
+static inline __attribute__((always_inline))
+void isortWith(void* array, size_t num, size_t size, int (*comp)(void* a, void* b), void* key)
 {
     for (size_t j = 1; j < num; j++)
     {
-        void* key = malloc(size);
-        memcpy(key, array + j * size, size);
-        long int i = j - 1;
+        void* cur = array + j * size;
+
+        // already in place, the common case for nearly sorted input
+        if (CMP(cur - size, cur) <= 0)
+            continue;
 
-        while (i >= 0 && comp(array + i * size, key) > 0)
+        // first element of array[0..j-1) greater than cur; inserting
+        // after any equal ones keeps the sort stable
+        size_t lo = 0, hi = j - 1;
+        while (lo < hi)
         {
-            memcpy(array + (i+1) * size, array + i * size, size);
-            i--;
+            size_t mid = lo + (hi - lo) / 2;
+
+            if (CMP(array + mid * size, cur) > 0)
+                hi = mid;
+            else
+                lo = mid + 1;
         }
-        memcpy(array + (i+1) * size, key, size);
-        free(key);
+
+        COPY(key, cur, 1, size);
+        MOVE(array + (lo + 1) * size, array + lo * size, j - lo, size);
+        COPY(array + lo * size, key, 1, size);
+    }
+}
+
+void isortSlot(void* array, size_t num, size_t size, int (*comp)(void* a, void* b), void* slot)
+{
+    switch (size)
+    {
+        case 1:  isortWith(array, num, 1, comp, slot);    break;
+        case 2:  isortWith(array, num, 2, comp, slot);    break;
+        case 4:  isortWith(array, num, 4, comp, slot);    break;
+        case 8:  isortWith(array, num, 8, comp, slot);    break;
+        default: isortWith(array, num, size, comp, slot); break;
     }
 }
 
+void isort(void* array, size_t num, size_t size, int (*comp)(void* a, void* b))
+{
+    if (size <= ISORT_STACK_SLOT)
+    {
+        _Alignas(16) unsigned char slot[ISORT_STACK_SLOT];
+        isortSlot(array, num, size, comp, slot);
+        return;
+    }
+
+    void* slot = malloc(size);
+    if (!slot)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return;
+    }
+    STAT_ALLOC(size);
+
+    isortSlot(array, num, size, comp, slot);
+    free(slot);
+}
+
+#ifdef ISORT_STATS
+
+void resetSortStats(void)
+{
+    memset(&isortStats, 0, sizeof(isortStats));
+}
+
+void printSortStats(void)
+{
+    printf("comparisons : %llu, moves : %llu, bytes copied : %llu, "
+           "allocations : %llu, peak scratch : %zu bytes\n",
+           isortStats.comparisons, isortStats.moves, isortStats.bytesCopied,
+           isortStats.allocations, isortStats.peakScratch);
+}
+
+#endif
+
 int compareInt(void* a, void* b)
 {
-    return *((int* )a) - *((int* )b);
+    // the difference overflows for keys far apart
+    int x = *((int* )a), y = *((int* )b);
+    return (x > y) - (x < y);
 }
 
 int compareFloat(void* a, void* b)
 {
-    return *((float* )a) - *((float* )b);
+    // the difference truncates to 0 for keys less than 1 apart
+    float x = *((float* )a), y = *((float* )b);
+    return (x > y) - (x < y);
 }
 
 int compareChar(void* a, void* b)
@@ -2,22 +2,82 @@
  *   Insertion sort
  *   --------------
  *   (using integer data type)
+ *
+ *   Usage :-
+ *
+ *    isort [array]                 sort the keys given as arguments
+ *    isort [-b] [-B] file          sort the keys in file ("-" for stdin)
+ *
+ *     -b   the input is raw native-endian ints instead of text
+ *     -B   write the sorted keys as raw ints instead of text
+ *
+ *   Text input is decimal ints separated by whitespace or commas;
+ *   regular files are mapped with mmap() and parsed in place, and
+ *   the output goes out in large write()s, one key per line.
+ *
+ *   Insertion sort takes O(n^2) time, so this is for small inputs;
+ *   beyond ISORT_WARN_KEYS keys a warning suggests msort instead.
+ *   The key I/O code is in ../keyio.h, shared with msort-int.c.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../keyio.h"
+
+// inputs larger than this will take a long time to sort
+#define ISORT_WARN_KEYS (1 << 16)
 
 void printArray(const int* array, const size_t size);
 void isort(int* array, const size_t size);
 
 int main(int argc, char* argv[])
 {
-    if (argc < 2)
+    int binaryIn = 0, binaryOut = 0, argi = 1;
+
+    // leading options; "-5" is a key and not an option
+    for (; argi < argc && argv[argi][0] == '-' && argv[argi][1] >= 'A'; argi++)
+    {
+        if (!strcmp(argv[argi], "-b"))
+            binaryIn = 1;
+        else if (!strcmp(argv[argi], "-B"))
+            binaryOut = 1;
+        else
+        {
+            argi = argc;
+            break;
+        }
+    }
+
+    int streaming = binaryIn || binaryOut || !isKeyList(argv + argi, argc - argi);
+
+    if (argi == argc || (streaming && argc - argi != 1))
     {
-        printf("isort : Usage is 'isort [array]'\n");
+        printf("isort : Usage is 'isort [array]' or 'isort [-b] [-B] file'\n");
         return 1;
     }
 
+    if (streaming)
+    {
+        int* keys;
+        size_t n;
+
+        if (readKeys(argv[argi], binaryIn, &keys, &n))
+            return 1;
+
+        if (n > ISORT_WARN_KEYS)
+            fprintf(stderr, "[WARNING] Insertion sort is O(n^2), %zu keys will take "
+                            "a long time; msort is better suited\n", n);
+
+        isort(keys, n);
+
+        int status = writeKeys(STDOUT_FILENO, keys, n, binaryOut);
+        free(keys);
+        return status ? 1 : 0;
+    }
+
     size_t size = argc - 1;
     // allocate memory dynamically for the array
     int* array = (int* )calloc(size, sizeof(int));
@@ -50,14 +110,15 @@ void isort(int* array, const size_t size)
 {
     for (size_t j = 1; j < size; j++)
     {
-        int key = array[j], i = j - 1;
+        int key = array[j];
+        size_t i = j;
 
-        while (i >= 0 && array[i] > key)
+        while (i > 0 && array[i - 1] > key)
         {
-            array[i + 1] = array[i];
+            array[i] = array[i - 1];
             i--;
         }
 
-        array[i + 1] = key;
+        array[i] = key;
     }
 }
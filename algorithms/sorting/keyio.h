@@ -0,0 +1,289 @@
+/*
+ *  Input and output of int keys
+ *  ----------------------------
+ *
+ *  Shared by isort-int.c and msort-int.c, which include it.
+ *
+ *  Text input is decimal ints separated by whitespace or commas;
+ *  regular files are mapped with mmap() and parsed in place, and
+ *  the output goes out in large write()s, one key per line. Binary
+ *  input and output are raw native-endian ints.
+ */
+
+#ifndef KEYIO_H
+#define KEYIO_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// size of the read and write buffers
+#define IO_BUFFER_SIZE (1 << 20)
+
+#define IS_SEPARATOR(c) ((c) == ' ' || (c) == '\n' || (c) == ',' || \
+                         (c) == '\t' || (c) == '\r')
+
+// read every key of the file at path ("-" for stdin), either as
+// text (decimal ints separated by whitespace or commas) or as raw
+// native-endian ints; *keys is to be released with free()
+// returns 0 on success, -1 on error
+int readKeys(const char* path, int binary, int** keys, size_t* n);
+
+// parse the decimal ints in buf[0, len) into keys[], which has room
+// for (len + 1) / 2 of them
+// returns the number of keys, or (size_t)-1 on malformed input
+size_t parseKeys(const char* buf, size_t len, int* keys);
+
+// write keys[0, n) to fd, one per line or as raw ints
+// returns 0 on success, -1 on error
+int writeKeys(int fd, const int* keys, size_t n, int binary);
+int writeAll(int fd, const void* buf, size_t len);
+
+// non-zero if every string in args[0, count) is a decimal int
+int isKeyList(char** args, int count);
+
+int readKeys(const char* path, int binary, int** keys, size_t* n)
+{
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY) : STDIN_FILENO;
+    if (fd < 0)
+    {
+        fprintf(stderr, "[ERROR] Cannot open %s\n", path);
+        return -1;
+    }
+
+    struct stat st;
+    char* buf = NULL;
+    size_t len = 0;
+    int mapped = 0, status = -1;
+
+    // regular files are mapped, pipes and terminals are read through
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        len = (size_t)st.st_size;
+        buf = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (buf == MAP_FAILED)
+            buf = NULL;
+        else
+        {
+            mapped = 1;
+            madvise(buf, len, MADV_SEQUENTIAL);
+        }
+    }
+
+    if (!mapped)
+    {
+        size_t cap = IO_BUFFER_SIZE;
+        ssize_t got;
+
+        len = 0;
+        buf = (char* )malloc(cap);
+        while (buf && (got = read(fd, buf + len, cap - len)) != 0)
+        {
+            if (got < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                fprintf(stderr, "[ERROR] Cannot read %s\n", path);
+                goto done;
+            }
+
+            len += (size_t)got;
+            if (len == cap)
+            {
+                char* grown = (char* )realloc(buf, cap *= 2);
+                if (!grown)
+                    free(buf);
+                buf = grown;
+            }
+        }
+
+        if (!buf)
+        {
+            fprintf(stderr, "[ERROR] Memory error\n");
+            goto done;
+        }
+    }
+
+    if (binary)
+    {
+        if (len % sizeof(int))
+        {
+            fprintf(stderr, "[ERROR] %s is not a whole number of ints\n", path);
+            goto done;
+        }
+
+        *n = len / sizeof(int);
+        *keys = (int* )malloc(len ? len : 1);
+        if (!*keys)
+        {
+            fprintf(stderr, "[ERROR] Memory error\n");
+            goto done;
+        }
+        memcpy(*keys, buf, len);
+    }
+    else
+    {
+        *keys = (int* )malloc(((len + 1) / 2 + 1) * sizeof(int));
+        if (!*keys)
+        {
+            fprintf(stderr, "[ERROR] Memory error\n");
+            goto done;
+        }
+
+        *n = parseKeys(buf, len, *keys);
+        if (*n == (size_t)-1)
+        {
+            free(*keys);
+            goto done;
+        }
+
+        // give back the room of the separators
+        int* shrunk = (int* )realloc(*keys, (*n + 1) * sizeof(int));
+        if (shrunk)
+            *keys = shrunk;
+    }
+
+    status = 0;
+
+done:
+    if (mapped)
+        munmap(buf, len);
+    else
+        free(buf);
+
+    if (fd != STDIN_FILENO)
+        close(fd);
+
+    return status;
+}
+
+size_t parseKeys(const char* buf, size_t len, int* keys)
+{
+    const char* p = buf;
+    const char* end = buf + len;
+    size_t n = 0;
+
+    while (p < end)
+    {
+        if (IS_SEPARATOR(*p))
+        {
+            p++;
+            continue;
+        }
+
+        int negative = *p == '-';
+        if (*p == '-' || *p == '+')
+            p++;
+
+        // accumulate in 64 bits, and stop as soon as the key can not
+        // fit in an int any more
+        const char* digits = p;
+        uint64_t value = 0;
+        while (p < end && (unsigned)(*p - '0') < 10 && value <= (uint64_t)INT_MAX + 1)
+            value = value * 10 + (unsigned)(*p++ - '0');
+
+        if (p == digits || (p < end && !IS_SEPARATOR(*p)) ||
+            value > (uint64_t)INT_MAX + negative)
+        {
+            fprintf(stderr, "[ERROR] Bad key at byte %zu\n", (size_t)(digits - buf));
+            return (size_t)-1;
+        }
+
+        keys[n++] = negative ? (int)(0u - (unsigned)value) : (int)value;
+    }
+
+    return n;
+}
+
+int writeKeys(int fd, const int* keys, size_t n, int binary)
+{
+    if (binary)
+        return writeAll(fd, keys, n * sizeof(int));
+
+    char* buf = (char* )malloc(IO_BUFFER_SIZE);
+    if (!buf)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+
+    char* p = buf;
+    for (size_t i = 0; i < n; i++)
+    {
+        // room for "-2147483648\n"
+        if (IO_BUFFER_SIZE - (size_t)(p - buf) < 12)
+        {
+            if (writeAll(fd, buf, (size_t)(p - buf)))
+            {
+                free(buf);
+                return -1;
+            }
+            p = buf;
+        }
+
+        unsigned value = keys[i] < 0 ? 0u - (unsigned)keys[i] : (unsigned)keys[i];
+        char digits[10];
+        int k = 0;
+
+        do
+        {
+            digits[k++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value);
+
+        if (keys[i] < 0)
+            *p++ = '-';
+        while (k)
+            *p++ = digits[--k];
+        *p++ = '\n';
+    }
+
+    int status = writeAll(fd, buf, (size_t)(p - buf));
+    free(buf);
+    return status;
+}
+
+int writeAll(int fd, const void* buf, size_t len)
+{
+    const char* p = (const char* )buf;
+
+    while (len)
+    {
+        ssize_t put = write(fd, p, len);
+        if (put < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "[ERROR] Write error\n");
+            return -1;
+        }
+
+        p += put;
+        len -= (size_t)put;
+    }
+
+    return 0;
+}
+
+int isKeyList(char** args, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        char* end;
+        errno = 0;
+        long value = strtol(args[i], &end, 10);
+        if (end == args[i] || *end || errno || value < INT_MIN || value > INT_MAX)
+            return 0;
+    }
+
+    return 1;
+}
+
+#endif // KEYIO_H
@@ -0,0 +1,522 @@
+/*
+ *  K-way merge
+ *  ===========
+ *
+ *  Merges k sorted inputs into one sorted output with a loser tree
+ *  (tournament tree). Every internal node of the tree holds the
+ *  loser of the match played there, and the overall winner sits
+ *  above the root; once the winner has been output, only the path
+ *  from its leaf to the root is replayed, so each element costs
+ *  about log2(k) comparisons, against 2 log2(k) for a binary heap.
+ *
+ *  The merge is stable: equal elements come out in the order of
+ *  the inputs they come from.
+ *
+ *  Three entry points :-
+ *   => kwayMerge()       : k sorted spans in memory, generic elements
+ *   => kwayMergeStream() : k sources that hand out one element at a
+ *                          time, generic elements
+ *   => kwayMergeInt()    : k sorted int arrays; the key and the input
+ *                          no. are packed in one 64-bit integer, so
+ *                          that a match is a single integer compare
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // for memcpy()
+#include <stdint.h>
+#include <time.h>
+
+/*
+ *  Declarations
+ */
+
+typedef signed char (*compare_fun)(void*, void*);
+
+/* A sorted input in memory */
+typedef struct KSpan
+{
+    void*  base;
+    size_t n;     // no. of elements
+} KSpan;
+
+// returns the next element of a streaming input, or NULL at its end;
+// the element has to stay valid until the next call on that input
+typedef void* (*next_fun)(void* ctx);
+
+/* A sorted streaming input */
+typedef struct KSource
+{
+    next_fun next;
+    void*    ctx;
+} KSource;
+
+// receives the merged elements, in order
+typedef void (*emit_fun)(void* ctx, void* element);
+
+/* A loser tree over k inputs */
+typedef struct LoserTree
+{
+    size_t      k;
+    size_t*     tree;    // tree[0] is the winner, tree[1..k) the losers
+    void**      head;    // current element of each input, NULL at its end
+    compare_fun compare;
+} LoserTree;
+
+// to be called by the user
+
+// merge the k sorted spans into out, which has room for all of them
+// returns 0 on success, -1 on memory error
+int kwayMerge(const KSpan* spans, size_t k, void* out, size_t dataSize, compare_fun compare);
+
+// merge the k sorted sources, passing every element to emit
+// returns the no. of elements merged, or (size_t)-1 on memory error
+size_t kwayMergeStream(KSource* sources, size_t k, compare_fun compare,
+                       emit_fun emit, void* emitCtx);
+
+// merge the k sorted int arrays runs[i][0..lens[i]) into out
+// returns 0 on success, -1 on memory error
+int kwayMergeInt(const int* const* runs, const size_t* lens, size_t k, int* out);
+
+/* Loser tree */
+
+// allocate a tree for k inputs; the heads are filled in by the caller
+// returns 0 on success, -1 on memory error
+int loserTreeAlloc(LoserTree* lt, size_t k, compare_fun compare);
+void loserTreeFree(LoserTree* lt);
+
+// play every match, once the heads are set
+// returns 0 on success, -1 on memory error
+int loserTreeBuild(LoserTree* lt);
+
+// replay the matches from the leaf of the winner, after its head moved
+void loserTreeReplay(LoserTree* lt);
+
+// non-zero if input a's head goes before input b's; exhausted inputs
+// go last, and ties go to the earlier input
+int beats(LoserTree* lt, size_t a, size_t b);
+
+/*
+ *  Compare functions for int type
+ */
+signed char compareInt(void* t1, void* t2);
+
+// the same, counting its calls in compareCalls
+signed char compareIntCounted(void* t1, void* t2);
+unsigned long long compareCalls;
+
+/* Streaming demo : an arithmetic sequence */
+typedef struct Sequence
+{
+    int    current; // the element last handed out
+    int    value;
+    int    step;
+    size_t left;
+} Sequence;
+
+void* nextInSequence(void* ctx);
+
+/* Streaming demo : check the order of what comes out */
+typedef struct OrderCheck
+{
+    int    last;
+    size_t count;
+    size_t unordered;
+} OrderCheck;
+
+void checkOrder(void* ctx, void* element);
+
+/* Helpers */
+void printIntArray(int* array, size_t n);
+double elapsed(struct timespec start);
+int compareIntQsort(const void* t1, const void* t2);
+
+int main()
+{
+    int r0[] = { 1, 4, 9 }, r1[] = { 2, 3, 10, 11 }, r2[] = { 0, 4, 5 };
+    const int* runs[] = { r0, r1, r2 };
+    size_t lens[] = { 3, 4, 3 };
+    KSpan spans[] = { { r0, 3 }, { r1, 4 }, { r2, 3 } };
+    int out[10];
+
+    printf("Test : K-way merge :-\n\n");
+    printIntArray(r0, 3);
+    printIntArray(r1, 4);
+    printIntArray(r2, 3);
+
+    printf("\nWith kwayMerge():-\n");
+    kwayMerge(spans, 3, out, sizeof(int), compareInt);
+    printIntArray(out, 10);
+
+    printf("\nWith kwayMergeInt():-\n");
+    kwayMergeInt(runs, lens, 3, out);
+    printIntArray(out, 10);
+
+    printf("\nWith kwayMergeStream() on 5 sequences:-\n");
+    Sequence seqs[5];
+    KSource sources[5];
+    for (int i = 0; i < 5; i++)
+    {
+        seqs[i] = (Sequence){ 0, i, i + 2, 1000 };
+        sources[i] = (KSource){ nextInSequence, &seqs[i] };
+    }
+    OrderCheck check = { 0, 0, 0 };
+    kwayMergeStream(sources, 5, compareInt, checkOrder, &check);
+    printf("%zu elements, %zu out of order\n", check.count, check.unordered);
+
+    // shards of a larger array, for several k
+    size_t total = 1 << 22, i;
+    int* input = (int* )malloc(total * sizeof(int));
+    int* all = (int* )malloc(total * sizeof(int));
+    int* ref = (int* )malloc(total * sizeof(int));
+    int* merged = (int* )malloc(total * sizeof(int));
+
+    srand(1);
+    for (i = 0; i < total; i++)
+        input[i] = rand();
+
+    memcpy(ref, input, total * sizeof(int));
+    qsort(ref, total, sizeof(int), compareIntQsort);
+
+    printf("\nWith %zu ints in k sorted shards:-\n", total);
+    for (size_t k = 4; k <= 256; k *= 4)
+    {
+        KSpan* shards = (KSpan* )malloc(k * sizeof(KSpan));
+        const int** shardRuns = (const int** )malloc(k * sizeof(int*));
+        size_t* shardLens = (size_t* )malloc(k * sizeof(size_t));
+
+        // the shards are sorted in place, so every k starts over from
+        // the random input rather than from the previous k's runs
+        memcpy(all, input, total * sizeof(int));
+        for (i = 0; i < k; i++)
+        {
+            size_t first = total / k * i, last = i == k - 1 ? total : total / k * (i + 1);
+            qsort(all + first, last - first, sizeof(int), compareIntQsort);
+            shards[i] = (KSpan){ all + first, last - first };
+            shardRuns[i] = all + first;
+            shardLens[i] = last - first;
+        }
+
+        struct timespec start;
+        compareCalls = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kwayMerge(shards, k, merged, sizeof(int), compareIntCounted);
+        double generic = elapsed(start);
+        int ok = memcmp(merged, ref, total * sizeof(int)) == 0;
+
+        memset(merged, 0, total * sizeof(int));
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kwayMergeInt(shardRuns, shardLens, k, merged);
+        double specialized = elapsed(start);
+        ok = ok && memcmp(merged, ref, total * sizeof(int)) == 0;
+
+        printf("k = %3zu : generic %7.2f ms (%.2f compares/element), int %7.2f ms, %s\n",
+               k, generic, (double)compareCalls / total, specialized, ok ? "sorted" : "WRONG");
+
+        free(shards);
+        free(shardRuns);
+        free(shardLens);
+    }
+
+    free(input);
+    free(all);
+    free(ref);
+    free(merged);
+
+    return 0;
+}
+
+/*
+ *  Definitions
+ */
+
+int loserTreeAlloc(LoserTree* lt, size_t k, compare_fun compare)
+{
+    lt->k = k;
+    lt->compare = compare;
+    lt->tree = (size_t* )malloc(k * sizeof(size_t));
+    lt->head = (void** )calloc(k, sizeof(void*));
+
+    if (!lt->tree || !lt->head)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        loserTreeFree(lt);
+        return -1;
+    }
+
+    return 0;
+}
+
+void loserTreeFree(LoserTree* lt)
+{
+    free(lt->tree);
+    free(lt->head);
+    lt->tree = NULL;
+    lt->head = NULL;
+}
+
+int beats(LoserTree* lt, size_t a, size_t b)
+{
+    if (!lt->head[a])
+        return 0;
+    if (!lt->head[b])
+        return 1;
+
+    signed char c = lt->compare(lt->head[a], lt->head[b]);
+    return c < 0 || (c == 0 && a < b);
+}
+
+int loserTreeBuild(LoserTree* lt)
+{
+    size_t k = lt->k, node;
+
+    // leaf i is node k + i, the parent of node x is x / 2; the
+    // winner of each match moves up, in win[], the loser stays
+    size_t* win = (size_t* )malloc(2 * k * sizeof(size_t));
+    if (!win)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+
+    for (node = 0; node < k; node++)
+        win[k + node] = node;
+
+    for (node = k - 1; node >= 1; node--)
+    {
+        size_t l = win[2 * node], r = win[2 * node + 1];
+
+        if (beats(lt, l, r))
+        {
+            win[node] = l;
+            lt->tree[node] = r;
+        }
+        else
+        {
+            win[node] = r;
+            lt->tree[node] = l;
+        }
+    }
+
+    lt->tree[0] = win[1];
+    free(win);
+    return 0;
+}
+
+void loserTreeReplay(LoserTree* lt)
+{
+    size_t w = lt->tree[0];
+
+    for (size_t node = (lt->k + w) / 2; node >= 1; node /= 2)
+    {
+        // the stored loser wins this time: it moves up instead
+        if (beats(lt, lt->tree[node], w))
+        {
+            size_t t = lt->tree[node];
+            lt->tree[node] = w;
+            w = t;
+        }
+    }
+
+    lt->tree[0] = w;
+}
+
+int kwayMerge(const KSpan* spans, size_t k, void* out, size_t dataSize, compare_fun compare)
+{
+    if (k == 0)
+        return 0;
+
+    LoserTree lt;
+    size_t* pos = (size_t* )calloc(k, sizeof(size_t));
+    if (!pos || loserTreeAlloc(&lt, k, compare))
+    {
+        if (!pos)
+            fprintf(stderr, "[ERROR] Memory error\n");
+        free(pos);
+        return -1;
+    }
+
+    size_t i;
+    for (i = 0; i < k; i++)
+        lt.head[i] = spans[i].n ? spans[i].base : NULL;
+
+    if (loserTreeBuild(&lt))
+    {
+        loserTreeFree(&lt);
+        free(pos);
+        return -1;
+    }
+
+    while (lt.head[i = lt.tree[0]])
+    {
+        memcpy(out, lt.head[i], dataSize);
+        out += dataSize;
+
+        lt.head[i] = ++pos[i] < spans[i].n ? spans[i].base + pos[i] * dataSize : NULL;
+        loserTreeReplay(&lt);
+    }
+
+    loserTreeFree(&lt);
+    free(pos);
+    return 0;
+}
+
+size_t kwayMergeStream(KSource* sources, size_t k, compare_fun compare,
+                       emit_fun emit, void* emitCtx)
+{
+    if (k == 0)
+        return 0;
+
+    LoserTree lt;
+    if (loserTreeAlloc(&lt, k, compare))
+        return (size_t)-1;
+
+    size_t i, count = 0;
+    for (i = 0; i < k; i++)
+        lt.head[i] = sources[i].next(sources[i].ctx);
+
+    if (loserTreeBuild(&lt))
+    {
+        loserTreeFree(&lt);
+        return (size_t)-1;
+    }
+
+    while (lt.head[i = lt.tree[0]])
+    {
+        emit(emitCtx, lt.head[i]);
+        count++;
+
+        lt.head[i] = sources[i].next(sources[i].ctx);
+        loserTreeReplay(&lt);
+    }
+
+    loserTreeFree(&lt);
+    return count;
+}
+
+int kwayMergeInt(const int* const* runs, const size_t* lens, size_t k, int* out)
+{
+    if (k == 0)
+        return 0;
+
+    // A node holds (key with its sign bit flipped) << 32 | input no.,
+    // so that unsigned order is key order with ties broken by input;
+    // an exhausted input is UINT64_MAX, above any real entry.
+    uint64_t* tree = (uint64_t* )malloc(k * sizeof(uint64_t));
+    uint64_t* win = (uint64_t* )malloc(2 * k * sizeof(uint64_t));
+    size_t* pos = (size_t* )calloc(k, sizeof(size_t));
+    if (!tree || !win || !pos)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(tree);
+        free(win);
+        free(pos);
+        return -1;
+    }
+
+#define KMERGE_ENTRY(i) (pos[i] < lens[i] ? \
+        (uint64_t)((uint32_t)runs[i][pos[i]] ^ 0x80000000u) << 32 | (i) : UINT64_MAX)
+
+    // same layout as loserTreeBuild()
+    size_t i, node;
+    for (i = 0; i < k; i++)
+        win[k + i] = KMERGE_ENTRY(i);
+
+    for (node = k - 1; node >= 1; node--)
+    {
+        uint64_t l = win[2 * node], r = win[2 * node + 1];
+        win[node] = l < r ? l : r;
+        tree[node] = l < r ? r : l;
+    }
+
+    uint64_t w = win[1];
+    free(win);
+
+    while (w != UINT64_MAX)
+    {
+        i = (size_t)(uint32_t)w;
+        *out++ = (int)((uint32_t)(w >> 32) ^ 0x80000000u);
+
+        pos[i]++;
+        w = KMERGE_ENTRY(i);
+
+        // replay: the smaller of the stored loser and w moves up
+        for (node = (k + i) / 2; node >= 1; node /= 2)
+        {
+            uint64_t t = tree[node];
+            tree[node] = t < w ? w : t;
+            w = t < w ? t : w;
+        }
+    }
+
+#undef KMERGE_ENTRY
+
+    free(tree);
+    free(pos);
+    return 0;
+}
+
+void* nextInSequence(void* ctx)
+{
+    Sequence* s = (Sequence* )ctx;
+
+    if (s->left == 0)
+        return NULL;
+
+    s->left--;
+    s->current = s->value;
+    s->value += s->step;
+    return &s->current;
+}
+
+void checkOrder(void* ctx, void* element)
+{
+    OrderCheck* c = (OrderCheck* )ctx;
+    int x = *(int*)element;
+
+    if (c->count++ > 0 && x < c->last)
+        c->unordered++;
+    c->last = x;
+}
+
+signed char compareInt(void* t1, void* t2)
+{
+    int _t1 = *(int*)t1;
+    int _t2 = *(int*)t2;
+
+    if (_t1 < _t2)
+        return -1;
+    else if (_t1 > _t2)
+        return 1;
+    else
+        return 0;
+}
+
+signed char compareIntCounted(void* t1, void* t2)
+{
+    compareCalls++;
+    return compareInt(t1, t2);
+}
+
+int compareIntQsort(const void* t1, const void* t2)
+{
+    int _t1 = *(const int*)t1;
+    int _t2 = *(const int*)t2;
+
+    return (_t1 > _t2) - (_t1 < _t2);
+}
+
+void printIntArray(int* array, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        printf("%d ", array[i]);
+    printf("\n");
+}
+
+double elapsed(struct timespec start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
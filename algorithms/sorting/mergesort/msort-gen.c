@@ -2,11 +2,25 @@
  *  Generic merge sort
  *  ==================
  *
+ *  parallelMergeSort() uses POSIX threads, so compile with -pthread.
+ *
+ *  Compiling with -DMSORT_STATS fills msortStats with operation
+ *  counts (comparisons, moves, allocations, ...) as the sorts run;
+ *  without it the counting compiles away entirely.
+ *
+ *  mergeSortPrefix() is meant for comparators that look at several
+ *  fields or chase pointers: every record is reduced once to a
+ *  64-bit prefix of its key, the prefixes are compared as integers,
+ *  and compare is only called when two of them are equal.
+ *
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h> // for memcpy()
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h> // for sysconf()
 
 /*
  *  Declarations
@@ -14,6 +28,64 @@
 
 typedef signed char (*compare_fun)(void*, void*);
 
+/* Operation counters */
+typedef struct MSortStats
+{
+    unsigned long long comparisons;  // calls to compare
+    unsigned long long moves;        // elements copied or moved
+    unsigned long long bytesCopied;  // bytes copied or moved
+    unsigned long long allocations;  // calls to malloc() and calloc()
+    size_t             scratchBytes; // heap scratch currently held
+    size_t             peakScratch;  // maximum of scratchBytes
+    size_t             maxDepth;     // deepest recursion reached
+} MSortStats;
+
+#ifdef MSORT_STATS
+
+MSortStats msortStats;
+
+// recursion depth of the calling thread
+__thread size_t msortDepth;
+
+void resetSortStats(void);
+void printSortStats(void);
+
+void statAlloc(size_t bytes);
+void statFree(size_t bytes);
+void statEnter(void);
+
+// the counters are shared by the threads of parallelMergeSort()
+#define STAT_ADD(field, n)  __atomic_fetch_add(&msortStats.field, (n), __ATOMIC_RELAXED)
+
+#define CMP(a, b)           (STAT_ADD(comparisons, 1), compare(a, b))
+#define COPY(d, s, n, size) (STAT_ADD(moves, (n)), STAT_ADD(bytesCopied, (n) * (size)), \
+                             memcpy(d, s, (n) * (size)))
+#define MOVE(d, s, n, size) (STAT_ADD(moves, (n)), STAT_ADD(bytesCopied, (n) * (size)), \
+                             memmove(d, s, (n) * (size)))
+#define STAT_ALLOC(bytes)   statAlloc(bytes)
+#define STAT_FREE(bytes)    statFree(bytes)
+#define STAT_ENTER()        statEnter()
+#define STAT_LEAVE()        msortDepth--
+
+// a new thread of parallelMergeSort() carries on from the
+// depth at which its task was split off
+#define STAT_DEPTH()        msortDepth
+#define STAT_SET_DEPTH(d)   (msortDepth = (d))
+
+#else
+
+#define CMP(a, b)           compare(a, b)
+#define COPY(d, s, n, size) memcpy(d, s, (n) * (size))
+#define MOVE(d, s, n, size) memmove(d, s, (n) * (size))
+#define STAT_ALLOC(bytes)
+#define STAT_FREE(bytes)
+#define STAT_ENTER()
+#define STAT_LEAVE()
+#define STAT_DEPTH()        0
+#define STAT_SET_DEPTH(d)
+
+#endif
+
 void merge(void* array        ,
            size_t low         ,
            size_t mid         ,
@@ -34,6 +106,272 @@ void mergeSort(void* array        ,
                size_t dataSize    ,
                compare_fun compare);
 
+/* Merge sort using a single scratch buffer */
+
+// to be called by the user
+//  => scratch - caller-owned buffer of at least (high - low + 1) * dataSize
+//               bytes that can be reused across calls; if NULL, a buffer
+//               is allocated (and released) internally
+void mergeSortScratch(void* array        ,
+                      size_t low         ,
+                      size_t high        ,
+                      size_t dataSize    ,
+                      compare_fun compare,
+                      void* scratch      );
+
+// sort the n elements of src into dst; both must hold the same
+// elements on entry and src is used as scratch space
+void msortInto(void* src, void* dst, size_t n, size_t dataSize, compare_fun compare);
+
+/* Bottom-up hybrid merge sort */
+
+// default length of the runs sorted by insertion sort
+#define MSORT_DEFAULT_RUN   32
+
+// merge passes are first done block by block, each block
+// being at most this many bytes, so that they stay in cache
+#define MSORT_BLOCK_BYTES   (256 * 1024)
+
+// to be called by the user
+//  => runSize - length of the runs that are sorted with insertion
+//               sort before merging, 0 means MSORT_DEFAULT_RUN
+// falls back to msort() if its buffer cannot be allocated
+void mergeSortBottomUp(void* array        ,
+                       size_t low         ,
+                       size_t high        ,
+                       size_t dataSize    ,
+                       compare_fun compare,
+                       size_t runSize     );
+
+// insertion sort the n elements of array, key is a one element scratch slot
+void insertionSortRun(void* array, size_t n, size_t dataSize,
+                      compare_fun compare, void* key);
+
+// merge adjacent pairs of width-element runs of src into dst
+void mergePass(void* src, void* dst, size_t n, size_t width,
+               size_t dataSize, compare_fun compare);
+
+/* Indirect merge sort */
+
+// sort a permutation of array[low..high] instead of moving the records
+//  => perm      - receives (high - low + 1) indices, relative to low, such
+//                 that array[low + perm[0]], array[low + perm[1]], ... is
+//                 in sorted order
+//  => keyOffset - if keyLen > 0, the first (at most 8) bytes of the
+//     keyLen      keyLen-byte key at this offset of each record are
+//                 cached next to its index as a prefix, as in
+//                 mergeSortPrefix(); the key has to be ordered like
+//                 memcmp() orders it (e.g. zero-padded strings and
+//                 big-endian integers), and compare is only called on
+//                 the records whose prefixes are equal
+// returns 0 on success, -1 on memory error
+int argSort(void* array        ,
+            size_t low         ,
+            size_t high        ,
+            size_t dataSize    ,
+            compare_fun compare,
+            size_t* perm       ,
+            size_t keyOffset   ,
+            size_t keyLen      );
+
+// move the records of array[low..high] so that array[low + i] becomes
+// the record previously at array[low + perm[i]], one cycle of the
+// permutation at a time so that each record is moved only once; perm
+// is left unchanged
+int applyPermutation(void* array, size_t low, size_t high, size_t dataSize, size_t* perm);
+
+// to be called by the user, for large records: argSort() followed by
+// applyPermutation()
+// returns 0 on success, -1 on memory error, leaving the array unchanged
+int mergeSortIndirect(void* array        ,
+                      size_t low         ,
+                      size_t high        ,
+                      size_t dataSize    ,
+                      compare_fun compare,
+                      size_t keyOffset   ,
+                      size_t keyLen      );
+
+// sort the n indices of src into dst by the records of base they
+// refer to; both must hold the same indices on entry
+void msortIndexInto(size_t* src, size_t* dst, size_t n, void* base,
+                    size_t dataSize, compare_fun compare);
+
+/* Merge sort on normalized key prefixes */
+
+// returns the first 64 bits of a record's key, normalized so that
+// records with different prefixes compare like the prefixes do as
+// unsigned integers; records with equal prefixes may compare any way
+typedef uint64_t (*prefix_fun)(void*);
+
+/* A record's prefix, and its index */
+typedef struct PrefixEntry
+{
+    uint64_t prefix;
+    size_t   index;
+} PrefixEntry;
+
+// to be called by the user; sorts (prefix, index) entries, calling
+// compare on the records only on equal prefixes, then moves every
+// record once with applyPermutation()
+void mergeSortPrefix(void* array        ,
+                     size_t low         ,
+                     size_t high        ,
+                     size_t dataSize    ,
+                     compare_fun compare,
+                     prefix_fun prefix  );
+
+// sort the n entries of src into dst; both must hold the same
+// entries on entry
+void msortPrefixInto(PrefixEntry* src, PrefixEntry* dst, size_t n, void* base,
+                     size_t dataSize, compare_fun compare);
+
+// normalized prefix of the first len (at most 8) bytes of key, for
+// keys ordered like memcmp(), e.g. strings and big-endian integers
+uint64_t bytesPrefix(const void* key, size_t len);
+
+/* Adaptive (natural run) merge sort */
+
+// minimum no. of consecutive wins of one run before merging gallops
+#define MSORT_MIN_GALLOP    7
+
+// enough runs for any array, as run lengths grow at least like
+// the Fibonacci numbers from the bottom of the stack to its top
+#define MSORT_MAX_RUNS      85
+
+/* State of an adaptive sort */
+typedef struct RunStack
+{
+    void*       base;                    // start of the array
+    size_t      dataSize;
+    compare_fun compare;
+    void*       tmp;                     // buffer of n / 2 + 1 elements
+    size_t      runBase[MSORT_MAX_RUNS]; // first index of each pending run
+    size_t      runLen[MSORT_MAX_RUNS];  // length of each pending run
+    size_t      size;                    // no. of pending runs
+} RunStack;
+
+// to be called by the user; finds the ascending and strictly
+// descending runs already present in the input, so that sorted
+// or reverse sorted input only takes n - 1 comparisons
+void mergeSortAdaptive(void* array        ,
+                       size_t low         ,
+                       size_t high        ,
+                       size_t dataSize    ,
+                       compare_fun compare);
+
+// length of the run at the start of array[0..n), reversed
+// in place if it is strictly descending
+size_t countRun(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot);
+
+// extend array[0..sorted) to array[0..n) by binary insertion
+void binaryInsertionRun(void* array, size_t n, size_t sorted, size_t dataSize,
+                        compare_fun compare, void* slot);
+
+// no. of elements of array[0..n) that are <= key, resp. < key,
+// found by exponential search followed by binary search
+size_t gallopRight(void* key, void* array, size_t n, size_t dataSize, compare_fun compare);
+size_t gallopLeft(void* key, void* array, size_t n, size_t dataSize, compare_fun compare);
+
+// merge the adjacent runs a[0..na) and a[na..na+nb), copying the
+// shorter one to rs->tmp and merging forwards, resp. backwards
+void mergeLo(RunStack* rs, void* a, size_t na, size_t nb);
+void mergeHi(RunStack* rs, void* a, size_t na, size_t nb);
+
+// merge the runs i and i + 1 of the stack
+void mergeAt(RunStack* rs, size_t i);
+
+// merge runs until the lengths on the stack satisfy
+// len[i - 2] > len[i - 1] + len[i] and len[i - 1] > len[i]
+void mergeCollapse(RunStack* rs);
+
+/* In-place merge sort */
+
+// size of the fixed buffer, on the stack, of mergeSortInPlace()
+#define MSORT_INPLACE_BYTES (8 * 1024)
+
+// to be called by the user; stable, and needs no memory beyond a
+// fixed buffer of MSORT_INPLACE_BYTES whatever the size of the range
+void mergeSortInPlace(void* array        ,
+                      size_t low         ,
+                      size_t high        ,
+                      size_t dataSize    ,
+                      compare_fun compare);
+
+// merge the adjacent runs array[0..na) and array[na..na+nb), through
+// buf (bufLen elements) when one of them fits in it, and by splitting
+// them around a rotation otherwise
+void mergeInPlace(void* array, size_t na, size_t nb, size_t dataSize,
+                  compare_fun compare, void* buf, size_t bufLen);
+
+// rotate array[0..n) left by k elements, swapping blocks through buf
+void rotate(void* array, size_t n, size_t k, size_t dataSize, void* buf, size_t bufLen);
+
+// exchange the disjoint blocks a[0..n) and b[0..n), through buf
+void swapBlocks(void* a, void* b, size_t n, size_t dataSize, void* buf, size_t bufLen);
+
+/* Parallel merge sort */
+
+// default no. of elements below which a range is sorted sequentially
+#define PMSORT_DEFAULT_CUTOFF 8192
+
+// to be called by the user
+//  => threads - no. of threads to use, 0 means one per online CPU
+//  => cutoff  - ranges of at most these many elements are sorted
+//               sequentially, 0 means PMSORT_DEFAULT_CUTOFF
+void parallelMergeSort(void* array        ,
+                       size_t low         ,
+                       size_t high        ,
+                       size_t dataSize    ,
+                       compare_fun compare,
+                       unsigned threads   ,
+                       size_t cutoff      );
+
+/* Sort task, one per subtree of the msort() recursion */
+typedef struct PSortTask
+{
+    void*       array;    // the whole array
+    void*       aux;      // scratch buffer as large as the array
+    size_t      low;      // first index of the range
+    size_t      high;     // last index of the range
+    size_t      dataSize;
+    compare_fun compare;
+    unsigned    threads;  // threads available to this subtree
+    size_t      cutoff;   // sequential cutoff
+    size_t      depth;    // recursion depth of the subtree, for the stats
+} PSortTask;
+
+/* Merge task, one per slice of the merged output */
+typedef struct PMergeTask
+{
+    void*       a;        // left run
+    size_t      na;
+    void*       b;        // right run
+    size_t      nb;
+    void*       out;      // output of the whole merge
+    size_t      first;    // first output position of this slice
+    size_t      last;     // one past the last output position
+    size_t      dataSize;
+    compare_fun compare;
+} PMergeTask;
+
+// merge the sorted runs a[0..na) and b[0..nb) into out
+void mergeRuns(void* a, size_t na, void* b, size_t nb, void* out,
+               size_t dataSize, compare_fun compare);
+
+// no. of elements of a[] among the first k elements of the
+// merge of a[] and b[] (merge-path co-ranking)
+size_t coRank(size_t k, void* a, size_t na, void* b, size_t nb,
+              size_t dataSize, compare_fun compare);
+
+// merge array[low..mid] and array[mid+1..high] using `threads` threads
+void parallelMerge(void* array, void* aux, size_t low, size_t mid,
+                   size_t high, size_t dataSize, compare_fun compare,
+                   unsigned threads);
+
+void psortRange(PSortTask* t);
+void* psortWorker(void* arg);
+void* pmergeWorker(void* arg);
+
 /*
  *  The compare method has to be defined by the user for
  *  all the types they want to call mergeSort() on.
@@ -42,6 +380,27 @@ signed char compareInt(void* t1, void* t2);
 signed char compareFloat(void* t1, void* t2);
 signed char compareChar(void* t1, void* t2);
 
+/* A record ordered by name, then age */
+typedef struct Person
+{
+    char name[24];
+    int  age;
+} Person;
+
+// counts its calls in personCompares
+signed char comparePerson(void* t1, void* t2);
+uint64_t personPrefix(void* t);
+
+unsigned long long personCompares;
+
+/* A record whose key is the string at its start */
+#define RECORD_KEY_LEN 16
+
+// counts its calls in recordCompares
+signed char compareRecord(void* t1, void* t2);
+
+unsigned long long recordCompares;
+
 /* Helpers */
 void printIntArray(void* array, size_t low, size_t high);
 void printFloatArray(void* array, size_t low, size_t high);
@@ -61,6 +420,9 @@ int main()
     printIntArray(iarr, 0, size - 1);
     mergeSort(iarr, 0, size-1, sizeof(int), compareInt);
     printIntArray(iarr, 0, size - 1);
+#ifdef MSORT_STATS
+    printSortStats();
+#endif
 
     printf("\nWith floating point array:-\n");
     printFloatArray(farr, 0, size - 1);
@@ -71,7 +433,138 @@ int main()
     printCharArray(carr, 0, size - 1);
     mergeSort(carr, 0, size-1, sizeof(char), compareChar);
     printCharArray(carr, 0, size - 1);
-    
+
+    printf("\nWith parallel mergesort on a larger integer array:-\n");
+    size_t bigSize = 1 << 20;
+    int* big = (int* )malloc(bigSize * sizeof(int));
+    srand(1);
+    for (size_t i = 0; i < bigSize; i++)
+        big[i] = rand() % 1000;
+#ifdef MSORT_STATS
+    resetSortStats();
+#endif
+    parallelMergeSort(big, 0, bigSize - 1, sizeof(int), compareInt, 4, 1 << 12);
+    size_t unordered = 0;
+    for (size_t i = 1; i < bigSize; i++)
+        unordered += big[i - 1] > big[i];
+    printf("%zu elements, %zu out of order\n", bigSize, unordered);
+#ifdef MSORT_STATS
+    printSortStats();
+#endif
+
+    printf("\nWith a reused scratch buffer:-\n");
+    void* scratch = malloc(bigSize * sizeof(int));
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < bigSize; i++)
+            big[i] = rand() % 1000;
+        mergeSortScratch(big, 0, bigSize - 1, sizeof(int), compareInt, scratch);
+        unordered = 0;
+        for (size_t i = 1; i < bigSize; i++)
+            unordered += big[i - 1] > big[i];
+        printf("pass %d : %zu elements, %zu out of order\n", pass + 1, bigSize, unordered);
+    }
+    free(scratch);
+
+    printf("\nWith bottom-up hybrid mergesort:-\n");
+    for (size_t run = 8; run <= 64; run *= 2)
+    {
+        for (size_t i = 0; i < bigSize; i++)
+            big[i] = rand() % 1000;
+        mergeSortBottomUp(big, 0, bigSize - 1, sizeof(int), compareInt, run);
+        unordered = 0;
+        for (size_t i = 1; i < bigSize; i++)
+            unordered += big[i - 1] > big[i];
+        printf("run size %zu : %zu elements, %zu out of order\n", run, bigSize, unordered);
+    }
+    free(big);
+
+    printf("\nWith indirect mergesort on 256 byte records:-\n");
+    size_t recSize = 256, recCount = 1 << 16;
+    void* recs = calloc(recCount, recSize);
+    for (int cached = 0; cached < 2 && recs; cached++)
+    {
+        // the key is a zero-padded decimal string at offset 0 of each
+        // record, whose first 8 bytes tie for most records
+        srand(3);
+        for (size_t i = 0; i < recCount; i++)
+            snprintf(recs + i * recSize, RECORD_KEY_LEN, "%012d", rand() % 1000000);
+
+        recordCompares = 0;
+        int status = mergeSortIndirect(recs, 0, recCount - 1, recSize, compareRecord, 0,
+                                       cached ? RECORD_KEY_LEN : 0);
+        unsigned long long calls = recordCompares;
+
+        unordered = 0;
+        for (size_t i = 1; i < recCount; i++)
+            unordered += compareRecord(recs + (i - 1) * recSize, recs + i * recSize) > 0;
+        printf("%s : %zu records, %zu out of order, %llu calls to compare%s\n",
+               cached ? "cached keys" : "indices    ", recCount, unordered, calls,
+               status ? " (memory error)" : "");
+    }
+    free(recs);
+
+    printf("\nWith adaptive mergesort on presorted data:-\n");
+    big = (int* )malloc(bigSize * sizeof(int));
+    for (int shape = 0; shape < 3; shape++)
+    {
+        // sorted, reversed, and sorted with 1% of random elements
+        for (size_t i = 0; i < bigSize; i++)
+            big[i] = shape == 1 ? (int)(bigSize - i) : (int)i;
+        if (shape == 2)
+            for (size_t i = 0; i < bigSize / 100; i++)
+                big[rand() % bigSize] = rand();
+        mergeSortAdaptive(big, 0, bigSize - 1, sizeof(int), compareInt);
+        unordered = 0;
+        for (size_t i = 1; i < bigSize; i++)
+            unordered += big[i - 1] > big[i];
+        printf("%-9s : %zu elements, %zu out of order\n",
+               shape == 0 ? "sorted" : shape == 1 ? "reversed" : "1% noise", bigSize, unordered);
+    }
+    free(big);
+
+    printf("\nWith in-place mergesort:-\n");
+    big = (int* )malloc(bigSize * sizeof(int));
+    for (size_t i = 0; i < bigSize; i++)
+        big[i] = rand() % 1000;
+    mergeSortInPlace(big, 0, bigSize - 1, sizeof(int), compareInt);
+    unordered = 0;
+    for (size_t i = 1; i < bigSize; i++)
+        unordered += big[i - 1] > big[i];
+    printf("%zu elements, %zu out of order\n", bigSize, unordered);
+    free(big);
+
+    printf("\nWith key prefixes on multi-field records:-\n");
+    size_t peopleCount = 1 << 18;
+    Person* people = (Person* )malloc(peopleCount * sizeof(Person));
+    for (int prefixed = 0; prefixed < 2; prefixed++)
+    {
+        // half of the names share their first 8 bytes, so that
+        // their prefixes tie and compare has to decide
+        srand(2);
+        for (size_t i = 0; i < peopleCount; i++)
+        {
+            snprintf(people[i].name, sizeof(people[i].name), "%s%c%c%c",
+                     i % 2 ? "Anderson" : "", 'a' + rand() % 26, 'a' + rand() % 26,
+                     'a' + rand() % 26);
+            people[i].age = rand() % 100;
+        }
+
+        personCompares = 0;
+        if (prefixed)
+            mergeSortPrefix(people, 0, peopleCount - 1, sizeof(Person), comparePerson, personPrefix);
+        else
+            mergeSort(people, 0, peopleCount - 1, sizeof(Person), comparePerson);
+        unsigned long long calls = personCompares;
+
+        unordered = 0;
+        for (size_t i = 1; i < peopleCount; i++)
+            unordered += comparePerson(&people[i - 1], &people[i]) > 0;
+        printf("%s : %zu records, %zu out of order, %llu calls to compare\n",
+               prefixed ? "mergeSortPrefix" : "mergeSort      ", peopleCount, unordered, calls);
+    }
+    free(people);
+
     return 0;
 }
 
@@ -87,34 +580,32 @@ void merge(void* array        ,
            compare_fun compare)
 {
     void* aux = malloc((high - low + 1) * dataSize);
+    STAT_ALLOC((high - low + 1) * dataSize);
 
     size_t i = low, j = mid + 1, k = 0;
 
     while (i <= mid && j <= high)
     {
-        if (compare(array + i * dataSize, array + j * dataSize) < 0)
-            memcpy(aux + k++ * dataSize, array + i++ * dataSize, dataSize);
-        else if (compare(array + i * dataSize, array + j * dataSize) > 0)
-            memcpy(aux + k++ * dataSize, array + j++ * dataSize, dataSize);
+        // one comparison per step; ties are taken from the left run
+        if (CMP(array + j * dataSize, array + i * dataSize) < 0)
+            COPY(aux + k++ * dataSize, array + j++ * dataSize, 1, dataSize);
         else
-        {
-            memcpy(aux + k++ * dataSize, array + i++ * dataSize, dataSize);
-            memcpy(aux + k++ * dataSize, array + j++ * dataSize, dataSize);
-        }
+            COPY(aux + k++ * dataSize, array + i++ * dataSize, 1, dataSize);
     }
 
     while (i <= mid)
-        memcpy(aux + k++ * dataSize, array + i++ * dataSize, dataSize);
+        COPY(aux + k++ * dataSize, array + i++ * dataSize, 1, dataSize);
 
     while (j <= high)
-        memcpy(aux + k++ * dataSize, array + j++ * dataSize, dataSize);
+        COPY(aux + k++ * dataSize, array + j++ * dataSize, 1, dataSize);
 
     i = low;
     k = 0;
 
     while (i <= high)
-        memcpy(array + i++ * dataSize, aux + k++ * dataSize, dataSize);
+        COPY(array + i++ * dataSize, aux + k++ * dataSize, 1, dataSize);
 
+    STAT_FREE((high - low + 1) * dataSize);
     free(aux);
 }
 
@@ -124,9 +615,11 @@ void msort(void* array, size_t low, size_t high, size_t dataSize, compare_fun co
     {
         size_t mid = (low + high) / 2;
 
+        STAT_ENTER();
         msort(array, low, mid, dataSize, compare);
         msort(array, mid + 1, high, dataSize, compare);
         merge(array, low, mid, high, dataSize, compare);
+        STAT_LEAVE();
     }
 
     return;
@@ -134,46 +627,1236 @@ void msort(void* array, size_t low, size_t high, size_t dataSize, compare_fun co
 
 void mergeSort(void* array, size_t low, size_t high, size_t dataSize, compare_fun compare)
 {
-    msort(array, low, high, dataSize, compare);
+    mergeSortScratch(array, low, high, dataSize, compare, NULL);
 }
 
-signed char compareInt(void* t1, void* t2)
+void msortInto(void* src, void* dst, size_t n, size_t dataSize, compare_fun compare)
 {
-    int _t1 = *(int*)t1;
-    int _t2 = *(int*)t2;
+    if (n < 2)
+        return;
 
-    if (_t1 < _t2)
-        return -1;
-    else if (_t1 > _t2)
-        return 1;
-    else
+    size_t half = n / 2;
+
+    // sort both halves of dst into src, then merge them back
+    // into dst, so that the roles of the buffers alternate at
+    // every level and no copy back is ever needed
+    STAT_ENTER();
+    msortInto(dst, src, half, dataSize, compare);
+    msortInto(dst + half * dataSize, src + half * dataSize, n - half, dataSize, compare);
+    mergeRuns(src, half, src + half * dataSize, n - half, dst, dataSize, compare);
+    STAT_LEAVE();
+}
+
+void mergeSortScratch(void* array, size_t low, size_t high, size_t dataSize,
+                      compare_fun compare, void* scratch)
+{
+    if (low >= high)
+        return;
+
+    size_t n = high - low + 1;
+    void* aux = scratch;
+
+    if (!aux)
+    {
+        aux = malloc(n * dataSize);
+        if (!aux)
+        {
+            // fall back to the per-merge allocating version
+            msort(array, low, high, dataSize, compare);
+            return;
+        }
+        STAT_ALLOC(n * dataSize);
+    }
+
+    COPY(aux, array + low * dataSize, n, dataSize);
+    msortInto(aux, array + low * dataSize, n, dataSize, compare);
+
+    if (!scratch)
+    {
+        STAT_FREE(n * dataSize);
+        free(aux);
+    }
+}
+
+void insertionSortRun(void* array, size_t n, size_t dataSize,
+                      compare_fun compare, void* key)
+{
+    for (size_t j = 1; j < n; j++)
+    {
+        size_t i = j;
+
+        // find the insertion point first, then shift the
+        // greater elements with a single memmove()
+        while (i > 0 && CMP(array + (i - 1) * dataSize, array + j * dataSize) > 0)
+            i--;
+
+        if (i == j)
+            continue;
+
+        COPY(key, array + j * dataSize, 1, dataSize);
+        MOVE(array + (i + 1) * dataSize, array + i * dataSize, j - i, dataSize);
+        COPY(array + i * dataSize, key, 1, dataSize);
+    }
+}
+
+void mergePass(void* src, void* dst, size_t n, size_t width,
+               size_t dataSize, compare_fun compare)
+{
+    for (size_t i = 0; i < n; i += 2 * width)
+    {
+        size_t mid = i + width < n ? i + width : n;
+        size_t end = mid + width < n ? mid + width : n;
+
+        // a lone trailing run is simply copied across
+        mergeRuns(src + i * dataSize, mid - i, src + mid * dataSize, end - mid,
+                  dst + i * dataSize, dataSize, compare);
+    }
+}
+
+void msortIndexInto(size_t* src, size_t* dst, size_t n, void* base,
+                    size_t dataSize, compare_fun compare)
+{
+    if (n < 2)
+        return;
+
+    size_t half = n / 2, i = 0, j = half, k = 0;
+
+    STAT_ENTER();
+    msortIndexInto(dst, src, half, base, dataSize, compare);
+    msortIndexInto(dst + half, src + half, n - half, base, dataSize, compare);
+    STAT_LEAVE();
+
+    while (i < half && j < n)
+    {
+        if (CMP(base + src[j] * dataSize, base + src[i] * dataSize) < 0)
+            dst[k++] = src[j++];
+        else
+            dst[k++] = src[i++];
+    }
+
+    while (i < half)
+        dst[k++] = src[i++];
+
+    while (j < n)
+        dst[k++] = src[j++];
+}
+
+int argSort(void* array, size_t low, size_t high, size_t dataSize,
+            compare_fun compare, size_t* perm, size_t keyOffset, size_t keyLen)
+{
+    size_t n = high - low + 1, i;
+    void* base = array + low * dataSize;
+
+    if (keyLen == 0)
+    {
+        size_t* aux = (size_t* )malloc(n * sizeof(size_t));
+        if (!aux)
+        {
+            fprintf(stderr, "[ERROR] Memory error\n");
+            return -1;
+        }
+        STAT_ALLOC(n * sizeof(size_t));
+
+        for (i = 0; i < n; i++)
+            perm[i] = aux[i] = i;
+
+        msortIndexInto(aux, perm, n, base, dataSize, compare);
+        STAT_FREE(n * sizeof(size_t));
+        free(aux);
         return 0;
+    }
+
+    // the sorted entries and their scratch copy
+    PrefixEntry* entries = (PrefixEntry* )malloc(2 * n * sizeof(PrefixEntry));
+    if (!entries)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+    STAT_ALLOC(2 * n * sizeof(PrefixEntry));
+
+    PrefixEntry* aux = entries + n;
+
+    for (i = 0; i < n; i++)
+    {
+        entries[i].prefix = bytesPrefix(base + i * dataSize + keyOffset, keyLen);
+        entries[i].index = i;
+        aux[i] = entries[i];
+    }
+
+    msortPrefixInto(aux, entries, n, base, dataSize, compare);
+
+    for (i = 0; i < n; i++)
+        perm[i] = entries[i].index;
+
+    STAT_FREE(2 * n * sizeof(PrefixEntry));
+    free(entries);
+    return 0;
 }
 
-signed char compareFloat(void* t1, void* t2)
+int applyPermutation(void* array, size_t low, size_t high, size_t dataSize, size_t* perm)
 {
-    float _t1 = *(float*)t1;
-    float _t2 = *(float*)t2;
+    size_t n = high - low + 1, i, j, k;
+    void* base = array + low * dataSize;
 
-    if (_t1 < _t2)
+    // one bit per record marks the ones already in place,
+    // the extra element after the bits holds a record
+    size_t bitBytes = (n + 7) / 8;
+    unsigned char* done = (unsigned char* )calloc(1, bitBytes + dataSize);
+    if (!done)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
         return -1;
-    else if (_t1 > _t2)
-        return 1;
-    else
-        return 0;
+    }
+    STAT_ALLOC(bitBytes + dataSize);
+    void* tmp = done + bitBytes;
+
+    for (i = 0; i < n; i++)
+    {
+        if ((done[i / 8] >> (i % 8)) & 1 || perm[i] == i)
+            continue;
+
+        // walk the cycle through i, pulling each record into place
+        COPY(tmp, base + i * dataSize, 1, dataSize);
+        for (j = i; ; j = k)
+        {
+            k = perm[j];
+            done[j / 8] |= 1 << (j % 8);
+            if (k == i)
+                break;
+            COPY(base + j * dataSize, base + k * dataSize, 1, dataSize);
+        }
+        COPY(base + j * dataSize, tmp, 1, dataSize);
+    }
+
+    STAT_FREE(bitBytes + dataSize);
+    free(done);
+    return 0;
 }
 
-signed char compareChar(void* t1, void* t2)
+int mergeSortIndirect(void* array, size_t low, size_t high, size_t dataSize,
+                      compare_fun compare, size_t keyOffset, size_t keyLen)
 {
-    int _t1 = *(char*)t1;
-    int _t2 = *(char*)t2;
+    if (low >= high)
+        return 0;
 
-    if (_t1 < _t2)
+    size_t* perm = (size_t* )malloc((high - low + 1) * sizeof(size_t));
+    if (!perm)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
         return -1;
-    else if (_t1 > _t2)
-        return 1;
+    }
+    STAT_ALLOC((high - low + 1) * sizeof(size_t));
+
+    // applyPermutation() fails before moving any record
+    int status = argSort(array, low, high, dataSize, compare, perm, keyOffset, keyLen);
+    if (status == 0)
+        status = applyPermutation(array, low, high, dataSize, perm);
+
+    STAT_FREE((high - low + 1) * sizeof(size_t));
+    free(perm);
+    return status;
+}
+
+void msortPrefixInto(PrefixEntry* src, PrefixEntry* dst, size_t n, void* base,
+                     size_t dataSize, compare_fun compare)
+{
+    if (n < 2)
+        return;
+
+    size_t half = n / 2, i = 0, j = half, k = 0;
+
+    STAT_ENTER();
+    msortPrefixInto(dst, src, half, base, dataSize, compare);
+    msortPrefixInto(dst + half, src + half, n - half, base, dataSize, compare);
+    STAT_LEAVE();
+
+    while (i < half && j < n)
+    {
+        // the records are only looked at when the prefixes tie
+        if (src[j].prefix < src[i].prefix ||
+            (src[j].prefix == src[i].prefix &&
+             CMP(base + src[j].index * dataSize, base + src[i].index * dataSize) < 0))
+            dst[k++] = src[j++];
+        else
+            dst[k++] = src[i++];
+    }
+
+    while (i < half)
+        dst[k++] = src[i++];
+
+    while (j < n)
+        dst[k++] = src[j++];
+}
+
+void mergeSortPrefix(void* array, size_t low, size_t high, size_t dataSize,
+                     compare_fun compare, prefix_fun prefix)
+{
+    if (low >= high)
+        return;
+
+    size_t n = high - low + 1, i;
+    void* base = array + low * dataSize;
+
+    // the sorted entries, their scratch copy, and the permutation
+    PrefixEntry* entries = (PrefixEntry* )malloc(2 * n * sizeof(PrefixEntry) + n * sizeof(size_t));
+    if (!entries)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return;
+    }
+    STAT_ALLOC(2 * n * sizeof(PrefixEntry) + n * sizeof(size_t));
+
+    PrefixEntry* aux = entries + n;
+    size_t* perm = (size_t* )(aux + n);
+
+    for (i = 0; i < n; i++)
+    {
+        entries[i].prefix = prefix(base + i * dataSize);
+        entries[i].index = i;
+        aux[i] = entries[i];
+    }
+
+    msortPrefixInto(aux, entries, n, base, dataSize, compare);
+
+    for (i = 0; i < n; i++)
+        perm[i] = entries[i].index;
+    applyPermutation(array, low, high, dataSize, perm);
+
+    STAT_FREE(2 * n * sizeof(PrefixEntry) + n * sizeof(size_t));
+    free(entries);
+}
+
+uint64_t bytesPrefix(const void* key, size_t len)
+{
+    const unsigned char* p = (const unsigned char* )key;
+    uint64_t prefix = 0;
+
+    // big-endian, so that the first byte is the most significant,
+    // and zero-padded, so that shorter keys come first
+    for (size_t i = 0; i < 8; i++)
+        prefix = prefix << 8 | (i < len ? p[i] : 0);
+
+    return prefix;
+}
+
+size_t countRun(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot)
+{
+    size_t k = 1;
+
+    if (n < 2)
+        return n;
+
+    if (CMP(array + dataSize, array) < 0)
+    {
+        // strictly descending, so that reversing it keeps equal
+        // elements in their original order
+        while (k < n && CMP(array + k * dataSize, array + (k - 1) * dataSize) < 0)
+            k++;
+
+        for (size_t i = 0, j = k - 1; i < j; i++, j--)
+        {
+            COPY(slot, array + i * dataSize, 1, dataSize);
+            COPY(array + i * dataSize, array + j * dataSize, 1, dataSize);
+            COPY(array + j * dataSize, slot, 1, dataSize);
+        }
+    }
     else
+    {
+        while (k < n && CMP(array + k * dataSize, array + (k - 1) * dataSize) >= 0)
+            k++;
+    }
+
+    return k;
+}
+
+void binaryInsertionRun(void* array, size_t n, size_t sorted, size_t dataSize,
+                        compare_fun compare, void* slot)
+{
+    for (size_t j = sorted; j < n; j++)
+    {
+        // insert after the elements equal to it, for stability
+        size_t i = gallopRight(array + j * dataSize, array, j, dataSize, compare);
+
+        if (i == j)
+            continue;
+
+        COPY(slot, array + j * dataSize, 1, dataSize);
+        MOVE(array + (i + 1) * dataSize, array + i * dataSize, j - i, dataSize);
+        COPY(array + i * dataSize, slot, 1, dataSize);
+    }
+}
+
+size_t gallopRight(void* key, void* array, size_t n, size_t dataSize, compare_fun compare)
+{
+    size_t last = 0, ofs = 1;
+
+    if (n == 0 || CMP(key, array) < 0)
         return 0;
+
+    // array[last] <= key; probe 1, 3, 7, ... until array[ofs] > key
+    while (ofs < n && CMP(key, array + ofs * dataSize) >= 0)
+    {
+        last = ofs;
+        ofs = 2 * ofs + 1;
+    }
+    if (ofs > n)
+        ofs = n;
+
+    // the answer lies in (last, ofs]
+    size_t lo = last + 1, hi = ofs;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (CMP(key, array + mid * dataSize) >= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+size_t gallopLeft(void* key, void* array, size_t n, size_t dataSize, compare_fun compare)
+{
+    size_t last = 0, ofs = 1;
+
+    if (n == 0 || CMP(key, array) <= 0)
+        return 0;
+
+    // array[last] < key; probe 1, 3, 7, ... until array[ofs] >= key
+    while (ofs < n && CMP(key, array + ofs * dataSize) > 0)
+    {
+        last = ofs;
+        ofs = 2 * ofs + 1;
+    }
+    if (ofs > n)
+        ofs = n;
+
+    size_t lo = last + 1, hi = ofs;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (CMP(key, array + mid * dataSize) > 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+void mergeLo(RunStack* rs, void* a, size_t na, size_t nb)
+{
+    size_t ds = rs->dataSize, i = 0, j = 0, c;
+    compare_fun compare = rs->compare;
+    void* t = rs->tmp;        // the left run
+    void* b = a + na * ds;    // the right run, still in place
+    void* d = a;              // next output position
+
+    COPY(t, a, na, ds);
+
+    while (i < na && j < nb)
+    {
+        size_t winsA = 0, winsB = 0;
+
+        // one element at a time, until one run keeps winning
+        while (i < na && j < nb && winsA < MSORT_MIN_GALLOP && winsB < MSORT_MIN_GALLOP)
+        {
+            if (CMP(b + j * ds, t + i * ds) < 0)
+            {
+                COPY(d, b + j++ * ds, 1, ds);
+                winsB++;
+                winsA = 0;
+            }
+            else
+            {
+                COPY(d, t + i++ * ds, 1, ds);
+                winsA++;
+                winsB = 0;
+            }
+            d += ds;
+        }
+
+        // galloping, copying whole stretches of a run at once,
+        // for as long as the stretches are long enough
+        while (i < na && j < nb)
+        {
+            c = gallopRight(b + j * ds, t + i * ds, na - i, ds, compare);
+            COPY(d, t + i * ds, c, ds);
+            d += c * ds;
+            i += c;
+            if (i == na)
+                break;
+
+            size_t c2 = gallopLeft(t + i * ds, b + j * ds, nb - j, ds, compare);
+            MOVE(d, b + j * ds, c2, ds);
+            d += c2 * ds;
+            j += c2;
+
+            if (c < MSORT_MIN_GALLOP && c2 < MSORT_MIN_GALLOP)
+                break;
+        }
+    }
+
+    // what is left of the right run is already in place
+    COPY(d, t + i * ds, na - i, ds);
+}
+
+void mergeHi(RunStack* rs, void* a, size_t na, size_t nb)
+{
+    size_t ds = rs->dataSize, i = na, j = nb, c;
+    compare_fun compare = rs->compare;
+    void* t = rs->tmp;        // the right run
+
+    COPY(t, a + na * ds, nb, ds);
+
+    // the output is filled from the back, i + j being one
+    // past the next output position
+    while (i > 0 && j > 0)
+    {
+        size_t winsA = 0, winsB = 0;
+
+        while (i > 0 && j > 0 && winsA < MSORT_MIN_GALLOP && winsB < MSORT_MIN_GALLOP)
+        {
+            if (CMP(t + (j - 1) * ds, a + (i - 1) * ds) < 0)
+            {
+                COPY(a + (i + j - 1) * ds, a + (i - 1) * ds, 1, ds);
+                i--;
+                winsA++;
+                winsB = 0;
+            }
+            else
+            {
+                COPY(a + (i + j - 1) * ds, t + (j - 1) * ds, 1, ds);
+                j--;
+                winsB++;
+                winsA = 0;
+            }
+        }
+
+        while (i > 0 && j > 0)
+        {
+            // elements of the left run greater than the right's last
+            c = i - gallopRight(t + (j - 1) * ds, a, i, ds, compare);
+            MOVE(a + (i + j - c) * ds, a + (i - c) * ds, c, ds);
+            i -= c;
+            if (i == 0)
+                break;
+
+            // elements of the right run not less than the left's last
+            size_t c2 = j - gallopLeft(a + (i - 1) * ds, t, j, ds, compare);
+            COPY(a + (i + j - c2) * ds, t + (j - c2) * ds, c2, ds);
+            j -= c2;
+
+            if (c < MSORT_MIN_GALLOP && c2 < MSORT_MIN_GALLOP)
+                break;
+        }
+    }
+
+    // what is left of the left run is already in place
+    COPY(a, t, j, ds);
+}
+
+void mergeAt(RunStack* rs, size_t i)
+{
+    size_t ds = rs->dataSize;
+    void* a = rs->base + rs->runBase[i] * ds;
+    size_t na = rs->runLen[i], nb = rs->runLen[i + 1];
+    void* b = a + na * ds;
+
+    rs->runLen[i] = na + nb;
+    if (i + 3 == rs->size)
+    {
+        rs->runBase[i + 1] = rs->runBase[i + 2];
+        rs->runLen[i + 1] = rs->runLen[i + 2];
+    }
+    rs->size--;
+
+    // elements of a not greater than b[0] are already in place
+    size_t k = gallopRight(b, a, na, ds, rs->compare);
+    a += k * ds;
+    na -= k;
+    if (na == 0)
+        return;
+
+    // so are the elements of b not less than the last one of a
+    nb = gallopLeft(a + (na - 1) * ds, b, nb, ds, rs->compare);
+    if (nb == 0)
+        return;
+
+    if (na <= nb)
+        mergeLo(rs, a, na, nb);
+    else
+        mergeHi(rs, a, na, nb);
+}
+
+void mergeCollapse(RunStack* rs)
+{
+    size_t* len = rs->runLen;
+
+    while (rs->size > 1)
+    {
+        size_t n = rs->size - 2;
+
+        if ((n > 0 && len[n - 1] <= len[n] + len[n + 1]) ||
+            (n > 1 && len[n - 2] <= len[n - 1] + len[n]))
+        {
+            if (len[n - 1] < len[n + 1])
+                n--;
+        }
+        else if (len[n] > len[n + 1])
+            break;
+
+        mergeAt(rs, n);
+    }
+}
+
+void mergeSortAdaptive(void* array, size_t low, size_t high, size_t dataSize,
+                       compare_fun compare)
+{
+    if (low >= high)
+        return;
+
+    size_t n = high - low + 1;
+
+    // a merge never copies more than the shorter of its runs
+    RunStack* rs = (RunStack* )malloc(sizeof(RunStack));
+    void* tmp = malloc((n / 2 + 1) * dataSize);
+    if (!rs || !tmp)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(rs);
+        free(tmp);
+        return;
+    }
+    STAT_ALLOC(sizeof(RunStack));
+    STAT_ALLOC((n / 2 + 1) * dataSize);
+
+    rs->base = array + low * dataSize;
+    rs->dataSize = dataSize;
+    rs->compare = compare;
+    rs->tmp = tmp;
+    rs->size = 0;
+
+    // runs shorter than minRun are extended by insertion sort; minRun
+    // is chosen so that n / minRun is a power of two, or just below
+    size_t minRun = n, r = 0;
+    while (minRun >= 64)
+    {
+        r |= minRun & 1;
+        minRun >>= 1;
+    }
+    minRun += r;
+
+    for (size_t lo = 0; lo < n; )
+    {
+        void* run = rs->base + lo * dataSize;
+        size_t len = countRun(run, n - lo, dataSize, compare, tmp);
+
+        if (len < minRun)
+        {
+            size_t forced = n - lo < minRun ? n - lo : minRun;
+            binaryInsertionRun(run, forced, len, dataSize, compare, tmp);
+            len = forced;
+        }
+
+        rs->runBase[rs->size] = lo;
+        rs->runLen[rs->size] = len;
+        rs->size++;
+        mergeCollapse(rs);
+
+        lo += len;
+    }
+
+    // merge whatever is left on the stack
+    while (rs->size > 1)
+    {
+        size_t i = rs->size - 2;
+        if (i > 0 && rs->runLen[i - 1] < rs->runLen[i + 1])
+            i--;
+        mergeAt(rs, i);
+    }
+
+    STAT_FREE((n / 2 + 1) * dataSize);
+    STAT_FREE(sizeof(RunStack));
+    free(tmp);
+    free(rs);
+}
+
+void mergeSortInPlace(void* array, size_t low, size_t high, size_t dataSize,
+                      compare_fun compare)
+{
+    if (low >= high)
+        return;
+
+    size_t n = high - low + 1, start, width;
+    void* base = array + low * dataSize;
+
+    // room for one element at least, in the rare case it is that large
+    char stackBuf[MSORT_INPLACE_BYTES];
+    void* buf = stackBuf;
+    size_t bufLen = MSORT_INPLACE_BYTES / dataSize;
+
+    if (bufLen == 0)
+    {
+        buf = malloc(dataSize);
+        if (!buf)
+        {
+            fprintf(stderr, "[ERROR] Memory error\n");
+            return;
+        }
+        STAT_ALLOC(dataSize);
+        bufLen = 1;
+    }
+
+    for (start = 0; start < n; start += MSORT_DEFAULT_RUN)
+        insertionSortRun(base + start * dataSize,
+                         n - start < MSORT_DEFAULT_RUN ? n - start : MSORT_DEFAULT_RUN,
+                         dataSize, compare, buf);
+
+    for (width = MSORT_DEFAULT_RUN; width < n; width *= 2)
+    {
+        for (start = 0; start + width < n; start += 2 * width)
+        {
+            size_t nb = n - start - width < width ? n - start - width : width;
+            mergeInPlace(base + start * dataSize, width, nb, dataSize, compare, buf, bufLen);
+        }
+    }
+
+    if (buf != stackBuf)
+    {
+        STAT_FREE(dataSize);
+        free(buf);
+    }
+}
+
+void mergeInPlace(void* array, size_t na, size_t nb, size_t dataSize,
+                  compare_fun compare, void* buf, size_t bufLen)
+{
+    while (na > 0 && nb > 0)
+    {
+        void* b = array + na * dataSize;
+
+        // the head of a[] that is <= b[0], and the tail of b[] that
+        // is >= the last of a[], are in place already
+        size_t skip = gallopRight(b, array, na, dataSize, compare);
+        array += skip * dataSize;
+        na -= skip;
+        if (na == 0)
+            return;
+        nb = gallopLeft(b - dataSize, b, nb, dataSize, compare);
+        if (nb == 0)
+            return;
+
+        if (na <= bufLen && na <= nb)
+        {
+            // forwards, from a copy of a[]; b[] is never overwritten
+            // before it has been read
+            size_t i = 0, j = 0, k = 0;
+
+            COPY(buf, array, na, dataSize);
+            while (i < na && j < nb)
+            {
+                if (CMP(b + j * dataSize, buf + i * dataSize) < 0)
+                    COPY(array + k++ * dataSize, b + j++ * dataSize, 1, dataSize);
+                else
+                    COPY(array + k++ * dataSize, buf + i++ * dataSize, 1, dataSize);
+            }
+            COPY(array + k * dataSize, buf + i * dataSize, na - i, dataSize);
+            return;
+        }
+
+        if (nb <= bufLen)
+        {
+            // backwards, from a copy of b[]; equal elements of a[]
+            // stay in front of those of b[]
+            size_t i = na, j = nb, k = na + nb;
+
+            COPY(buf, b, nb, dataSize);
+            while (i > 0 && j > 0)
+            {
+                if (CMP(buf + (j - 1) * dataSize, array + (i - 1) * dataSize) < 0)
+                    COPY(array + --k * dataSize, array + --i * dataSize, 1, dataSize);
+                else
+                    COPY(array + --k * dataSize, buf + --j * dataSize, 1, dataSize);
+            }
+            COPY(array, buf, j, dataSize);
+            return;
+        }
+
+        // Split the longer run in half, and the other one where the
+        // middle element would go, then bring the two inner parts in
+        // order with a rotation :-
+        //   a1 a2 b1 b2  =>  a1 b1 a2 b2
+        // and merge (a1, b1) and (a2, b2), looping on the larger pair
+        size_t cutA, cutB;
+        if (na >= nb)
+        {
+            cutA = na / 2;
+            cutB = gallopLeft(array + cutA * dataSize, b, nb, dataSize, compare);
+        }
+        else
+        {
+            cutB = nb / 2;
+            cutA = gallopRight(b + cutB * dataSize, array, na, dataSize, compare);
+        }
+
+        rotate(array + cutA * dataSize, na - cutA + cutB, na - cutA, dataSize, buf, bufLen);
+
+        void* mid = array + (cutA + cutB) * dataSize;
+        if (cutA + cutB <= na + nb - cutA - cutB)
+        {
+            mergeInPlace(array, cutA, cutB, dataSize, compare, buf, bufLen);
+            array = mid;
+            na -= cutA;
+            nb -= cutB;
+        }
+        else
+        {
+            mergeInPlace(mid, na - cutA, nb - cutB, dataSize, compare, buf, bufLen);
+            na = cutA;
+            nb = cutB;
+        }
+    }
+}
+
+void rotate(void* array, size_t n, size_t k, size_t dataSize, void* buf, size_t bufLen)
+{
+    // Gries-Mills block swaps, each putting one block in its final
+    // place, until the shorter side fits in the buffer
+    while (k > 0 && k < n)
+    {
+        size_t m = n - k;
+
+        if (k <= m)
+        {
+            if (k <= bufLen)
+            {
+                COPY(buf, array, k, dataSize);
+                MOVE(array, array + k * dataSize, m, dataSize);
+                COPY(array + m * dataSize, buf, k, dataSize);
+                return;
+            }
+
+            // [a b1 b2] => [b1 a b2], then rotate [a b2] by k
+            swapBlocks(array, array + k * dataSize, k, dataSize, buf, bufLen);
+            array += k * dataSize;
+            n -= k;
+        }
+        else
+        {
+            if (m <= bufLen)
+            {
+                COPY(buf, array + k * dataSize, m, dataSize);
+                MOVE(array + m * dataSize, array, k, dataSize);
+                COPY(array, buf, m, dataSize);
+                return;
+            }
+
+            // [a1 a2 b] => [a1 b a2], then rotate [a1 b] by k - m
+            swapBlocks(array + (k - m) * dataSize, array + k * dataSize, m, dataSize, buf, bufLen);
+            n -= m;
+            k -= m;
+        }
+    }
+}
+
+void swapBlocks(void* a, void* b, size_t n, size_t dataSize, void* buf, size_t bufLen)
+{
+    while (n > 0)
+    {
+        size_t c = n < bufLen ? n : bufLen;
+
+        COPY(buf, a, c, dataSize);
+        COPY(a, b, c, dataSize);
+        COPY(b, buf, c, dataSize);
+
+        a += c * dataSize;
+        b += c * dataSize;
+        n -= c;
+    }
+}
+
+void mergeSortBottomUp(void* array, size_t low, size_t high, size_t dataSize,
+                       compare_fun compare, size_t runSize)
+{
+    if (low >= high)
+        return;
+
+    if (runSize == 0)
+        runSize = MSORT_DEFAULT_RUN;
+
+    size_t n = high - low + 1, start, width;
+    void* base = array + low * dataSize;
+
+    // one extra element at the end is the insertion sort key slot
+    void* aux = malloc((n + 1) * dataSize);
+    if (!aux)
+    {
+        // fall back to the per-merge allocating version
+        msort(array, low, high, dataSize, compare);
+        return;
+    }
+    STAT_ALLOC((n + 1) * dataSize);
+
+    // Step 1 : insertion sort runs of runSize elements
+    for (start = 0; start < n; start += runSize)
+        insertionSortRun(base + start * dataSize, n - start < runSize ? n - start : runSize,
+                         dataSize, compare, aux + n * dataSize);
+
+    // largest power-of-two multiple of runSize that fits a cache block
+    size_t block = runSize;
+    while (block < n && 2 * block * dataSize <= MSORT_BLOCK_BYTES)
+        block *= 2;
+
+    // Step 2 : merge runs up to the block size, one block at a time;
+    // every block goes through the same no. of passes, so all blocks
+    // end up in the same buffer
+    void* src = base;
+    void* dst = aux;
+    int swaps = 0;
+
+    for (start = 0; start < n; start += block)
+    {
+        size_t len = n - start < block ? n - start : block;
+        void* s = src + start * dataSize;
+        void* d = dst + start * dataSize;
+
+        swaps = 0;
+        for (width = runSize; width < block; width *= 2, swaps++)
+        {
+            mergePass(s, d, len, width, dataSize, compare);
+            void* t = s; s = d; d = t;
+        }
+    }
+
+    if (swaps % 2)
+    {
+        src = aux;
+        dst = base;
+    }
+
+    // Step 3 : merge the blocks across the whole range
+    for (width = block; width < n; width *= 2)
+    {
+        mergePass(src, dst, n, width, dataSize, compare);
+        void* t = src; src = dst; dst = t;
+    }
+
+    if (src != base)
+        COPY(base, src, n, dataSize);
+
+    STAT_FREE((n + 1) * dataSize);
+    free(aux);
+}
+
+void mergeRuns(void* a, size_t na, void* b, size_t nb, void* out,
+               size_t dataSize, compare_fun compare)
+{
+    size_t i = 0, j = 0, k = 0;
+
+    // ties are taken from the left run to keep the sort stable
+    while (i < na && j < nb)
+    {
+        if (CMP(b + j * dataSize, a + i * dataSize) < 0)
+            COPY(out + k++ * dataSize, b + j++ * dataSize, 1, dataSize);
+        else
+            COPY(out + k++ * dataSize, a + i++ * dataSize, 1, dataSize);
+    }
+
+    if (i < na)
+        COPY(out + k * dataSize, a + i * dataSize, na - i, dataSize);
+    else if (j < nb)
+        COPY(out + k * dataSize, b + j * dataSize, nb - j, dataSize);
+}
+
+size_t coRank(size_t k, void* a, size_t na, void* b, size_t nb,
+              size_t dataSize, compare_fun compare)
+{
+    size_t lo = k > nb ? k - nb : 0;
+    size_t hi = k < na ? k : na;
+
+    // a[i] belongs to the first k outputs iff a[i] <= b[k - i - 1],
+    // which holds for every i below the answer and for none above
+    while (lo < hi)
+    {
+        size_t i = lo + (hi - lo) / 2;
+
+        if (CMP(a + i * dataSize, b + (k - i - 1) * dataSize) <= 0)
+            lo = i + 1;
+        else
+            hi = i;
+    }
+
+    return lo;
+}
+
+void* pmergeWorker(void* arg)
+{
+    PMergeTask* t = (PMergeTask* )arg;
+
+    size_t i0 = coRank(t->first, t->a, t->na, t->b, t->nb, t->dataSize, t->compare);
+    size_t i1 = coRank(t->last, t->a, t->na, t->b, t->nb, t->dataSize, t->compare);
+    size_t j0 = t->first - i0, j1 = t->last - i1;
+
+    mergeRuns(t->a + i0 * t->dataSize, i1 - i0,
+              t->b + j0 * t->dataSize, j1 - j0,
+              t->out + t->first * t->dataSize, t->dataSize, t->compare);
+
+    return NULL;
+}
+
+void parallelMerge(void* array, void* aux, size_t low, size_t mid,
+                   size_t high, size_t dataSize, compare_fun compare,
+                   unsigned threads)
+{
+    size_t n = high - low + 1;
+    PMergeTask* tasks = (PMergeTask* )malloc(threads * sizeof(PMergeTask));
+    pthread_t* tids = (pthread_t* )malloc(threads * sizeof(pthread_t));
+    int* spawned = (int* )malloc(threads * sizeof(int));
+
+    // without room for the task table, merge on this thread alone
+    if (!tasks || !tids || !spawned)
+    {
+        free(tasks);
+        free(tids);
+        free(spawned);
+        mergeRuns(array + low * dataSize, mid - low + 1,
+                  array + (mid + 1) * dataSize, high - mid,
+                  aux + low * dataSize, dataSize, compare);
+        COPY(array + low * dataSize, aux + low * dataSize, n, dataSize);
+        return;
+    }
+
+    // split the output into `threads` equal slices, each of
+    // which is merged independently after co-ranking its bounds
+    for (unsigned t = 0; t < threads; t++)
+    {
+        tasks[t].a = array + low * dataSize;
+        tasks[t].na = mid - low + 1;
+        tasks[t].b = array + (mid + 1) * dataSize;
+        tasks[t].nb = high - mid;
+        tasks[t].out = aux + low * dataSize;
+        tasks[t].first = n * t / threads;
+        tasks[t].last = n * (t + 1) / threads;
+        tasks[t].dataSize = dataSize;
+        tasks[t].compare = compare;
+    }
+
+    for (unsigned t = 1; t < threads; t++)
+        spawned[t] = pthread_create(&tids[t], NULL, pmergeWorker, &tasks[t]) == 0;
+
+    pmergeWorker(&tasks[0]);
+
+    // run the slices that could not get a thread of their own
+    for (unsigned t = 1; t < threads; t++)
+    {
+        if (spawned[t])
+            pthread_join(tids[t], NULL);
+        else
+            pmergeWorker(&tasks[t]);
+    }
+
+    free(tasks);
+    free(tids);
+    free(spawned);
+
+    COPY(array + low * dataSize, aux + low * dataSize, n, dataSize);
+}
+
+void psortRange(PSortTask* t)
+{
+    size_t n = t->high - t->low + 1;
+
+    if (t->threads <= 1 || n <= t->cutoff)
+    {
+        mergeSortScratch(t->array, t->low, t->high, t->dataSize, t->compare,
+                         t->aux + t->low * t->dataSize);
+        return;
+    }
+
+    size_t mid = (t->low + t->high) / 2;
+
+    // split the thread budget between the two halves; the
+    // left half is handed to a new thread, the right one is
+    // sorted by the current thread
+    PSortTask left = *t, right = *t;
+    left.high = mid;
+    left.threads = t->threads / 2;
+    right.low = mid + 1;
+    right.threads = t->threads - left.threads;
+
+    STAT_ENTER();
+    left.depth = right.depth = STAT_DEPTH();
+
+    pthread_t tid;
+    int spawned = pthread_create(&tid, NULL, psortWorker, &left) == 0;
+
+    if (!spawned)
+        psortRange(&left);
+    psortRange(&right);
+    if (spawned)
+        pthread_join(tid, NULL);
+    STAT_LEAVE();
+
+    parallelMerge(t->array, t->aux, t->low, mid, t->high,
+                  t->dataSize, t->compare, t->threads);
+}
+
+void* psortWorker(void* arg)
+{
+    STAT_SET_DEPTH(((PSortTask* )arg)->depth);
+    psortRange((PSortTask* )arg);
+    return NULL;
+}
+
+void parallelMergeSort(void* array, size_t low, size_t high, size_t dataSize,
+                       compare_fun compare, unsigned threads, size_t cutoff)
+{
+    if (low >= high)
+        return;
+
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+
+    if (cutoff == 0)
+        cutoff = PMSORT_DEFAULT_CUTOFF;
+
+    size_t n = high - low + 1;
+    void* aux = malloc(n * dataSize);
+    if (!aux)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return;
+    }
+    STAT_ALLOC(n * dataSize);
+
+    // the tasks work on array[low..high] rebased to 0..n-1,
+    // so that indices into array and aux line up
+    PSortTask t = { array + low * dataSize, aux, 0, n - 1,
+                    dataSize, compare, threads, cutoff, STAT_DEPTH() };
+    psortRange(&t);
+
+    STAT_FREE(n * dataSize);
+    free(aux);
+}
+
+#ifdef MSORT_STATS
+
+void resetSortStats(void)
+{
+    memset(&msortStats, 0, sizeof(msortStats));
+}
+
+void printSortStats(void)
+{
+    printf("comparisons : %llu, moves : %llu, bytes copied : %llu, "
+           "allocations : %llu, peak scratch : %zu bytes, max depth : %zu\n",
+           msortStats.comparisons, msortStats.moves, msortStats.bytesCopied,
+           msortStats.allocations, msortStats.peakScratch, msortStats.maxDepth);
+}
+
+void statAlloc(size_t bytes)
+{
+    STAT_ADD(allocations, 1);
+    size_t held = STAT_ADD(scratchBytes, bytes) + bytes;
+    size_t peak = __atomic_load_n(&msortStats.peakScratch, __ATOMIC_RELAXED);
+    while (held > peak &&
+           !__atomic_compare_exchange_n(&msortStats.peakScratch, &peak, held, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+void statFree(size_t bytes)
+{
+    __atomic_fetch_sub(&msortStats.scratchBytes, bytes, __ATOMIC_RELAXED);
+}
+
+void statEnter(void)
+{
+    size_t depth = ++msortDepth;
+    size_t deepest = __atomic_load_n(&msortStats.maxDepth, __ATOMIC_RELAXED);
+    while (depth > deepest &&
+           !__atomic_compare_exchange_n(&msortStats.maxDepth, &deepest, depth, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+#endif
+
+signed char compareInt(void* t1, void* t2)
+{
+    int _t1 = *(int*)t1;
+    int _t2 = *(int*)t2;
+
+    if (_t1 < _t2)
+        return -1;
+    else if (_t1 > _t2)
+        return 1;
+    else
+        return 0;
+}
+
+signed char compareFloat(void* t1, void* t2)
+{
+    float _t1 = *(float*)t1;
+    float _t2 = *(float*)t2;
+
+    if (_t1 < _t2)
+        return -1;
+    else if (_t1 > _t2)
+        return 1;
+    else
+        return 0;
+}
+
+signed char compareChar(void* t1, void* t2)
+{
+    int _t1 = *(char*)t1;
+    int _t2 = *(char*)t2;
+
+    if (_t1 < _t2)
+        return -1;
+    else if (_t1 > _t2)
+        return 1;
+    else
+        return 0;
+}
+
+signed char comparePerson(void* t1, void* t2)
+{
+    Person* _t1 = (Person*)t1;
+    Person* _t2 = (Person*)t2;
+
+    personCompares++;
+
+    int byName = strcmp(_t1->name, _t2->name);
+    if (byName)
+        return byName < 0 ? -1 : 1;
+
+    return (_t1->age > _t2->age) - (_t1->age < _t2->age);
+}
+
+signed char compareRecord(void* t1, void* t2)
+{
+    recordCompares++;
+
+    int byKey = strncmp((char*)t1, (char*)t2, RECORD_KEY_LEN);
+    return (byKey > 0) - (byKey < 0);
+}
+
+uint64_t personPrefix(void* t)
+{
+    Person* _t = (Person*)t;
+
+    // the name is compared as unsigned bytes by strcmp()
+    return bytesPrefix(_t->name, strnlen(_t->name, 8));
 }
 
 void printIntArray(void* array, size_t low, size_t high)
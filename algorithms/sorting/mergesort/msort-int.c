@@ -1,91 +1,302 @@
 /*
  *  Merge sort
+ *
+ *  Indices are size_t, and the merge buffer is allocated once per
+ *  sort on the heap, so arrays of billions of ints can be sorted.
+ *  Large buffers are mapped directly with mmap(), and backed by huge
+ *  pages where the kernel allows it, to cut down on TLB misses.
+ *
+ *  The merge loop has no data-dependent branches: the smaller head
+ *  is picked with a conditional move and the indices are advanced
+ *  by the outcome of the comparison. Once one run has won
+ *  MSORT_MIN_GALLOP times in a row, the length of its winning
+ *  stretch is found by exponential search and copied in one go.
+ *
+ *  Usage :-
+ *
+ *   msort                         sort a few arrays and check them
+ *   msort [array]                 sort the keys given as arguments
+ *   msort [-b] [-B] file          sort the keys in file ("-" for stdin)
+ *
+ *    -b   the input is raw native-endian ints instead of text
+ *    -B   write the sorted keys as raw ints instead of text
+ *
+ *  Text input is decimal ints separated by whitespace or commas;
+ *  regular files are mapped with mmap() and parsed in place, and
+ *  the output goes out in large write()s, one key per line. The key
+ *  I/O code is in ../keyio.h, shared with isort-int.c.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
-void merge(int* array, int low, int mid, int high);
-void msort(int* array, int low, int high);
-void mergeSort(int* array, int low, int high);
+#include "../keyio.h"
 
-void printIntArray(int* array, int low, int high);
+// scratch buffers of at least this many bytes are mapped directly
+#define MSORT_MMAP_THRESHOLD (2 << 20)
 
-/*int main(int argc, char* argv[])
+// no. of consecutive wins of one run before the merge gallops
+#define MSORT_MIN_GALLOP 7
+
+void merge(int* array, int* aux, size_t low, size_t mid, size_t high);
+void msort(int* array, int* aux, size_t low, size_t high);
+void mergeSort(int* array, size_t low, size_t high);
+
+// no. of elements of a[0, n) that are <= key, resp. < key,
+// found by exponential search followed by binary search
+size_t gallopRight(int key, const int* a, size_t n);
+size_t gallopLeft(int key, const int* a, size_t n);
+
+// allocate, resp. release, a scratch buffer of n ints
+int* allocScratch(size_t n);
+void freeScratch(int* aux, size_t n);
+
+void printIntArray(int* array, size_t low, size_t high);
+
+int main(int argc, char* argv[])
 {
-    if (argc < 2)
+    int binaryIn = 0, binaryOut = 0, argi = 1;
+
+    // leading options; "-5" is a key and not an option
+    for (; argi < argc && argv[argi][0] == '-' && argv[argi][1] >= 'A'; argi++)
     {
-        printf("msort : Usage is 'msort [unsorted-array]'\n");
-        return 0;
+        if (!strcmp(argv[argi], "-b"))
+            binaryIn = 1;
+        else if (!strcmp(argv[argi], "-B"))
+            binaryOut = 1;
+        else
+        {
+            argi = 0;
+            break;
+        }
+    }
+
+    if (argc > 1)
+    {
+        int streaming = binaryIn || binaryOut || !isKeyList(argv + argi, argc - argi);
+
+        if (argi == 0 || argi == argc || (streaming && argc - argi != 1))
+        {
+            printf("msort : Usage is 'msort [array]' or 'msort [-b] [-B] file'\n");
+            return 1;
+        }
+
+        int* keys;
+        size_t n;
+
+        if (streaming)
+        {
+            if (readKeys(argv[argi], binaryIn, &keys, &n))
+                return 1;
+        }
+        else
+        {
+            n = argc - argi;
+            keys = (int* )malloc(n * sizeof(int));
+            if (!keys)
+            {
+                fprintf(stderr, "[ERROR] Memory error\n");
+                return 1;
+            }
+            for (size_t i = 0; i < n; i++)
+                keys[i] = atoi(argv[argi + i]);
+        }
+
+        if (n > 1)
+            mergeSort(keys, 0, n - 1);
+
+        int status = streaming ? writeKeys(STDOUT_FILENO, keys, n, binaryOut) : 0;
+        if (!streaming)
+            printIntArray(keys, 0, n - 1);
+
+        free(keys);
+        return status ? 1 : 0;
     }
 
-    int arr[argc - 1];
-    for (int i = 1; i < argc; i++)
-        arr[i - 1] = atoi(argv[i]);
-*/
-int main()
-{
     int size = 10;
     int arr[] = { 9, 10, 8, 5, 1, 2, 4, 3, 6, 7 };
     printIntArray(arr, 0, size - 1);
     mergeSort(arr, 0, size - 1);
     printIntArray(arr, 0, size - 1);
 
+    // an array too large for the merge buffer to live on the stack
+    size_t bigSize = (size_t)1 << 24, unordered = 0;
+    int* big = (int* )malloc(bigSize * sizeof(int));
+    if (big)
+    {
+        srand(1);
+        for (size_t i = 0; i < bigSize; i++)
+            big[i] = rand();
+        mergeSort(big, 0, bigSize - 1);
+        for (size_t i = 1; i < bigSize; i++)
+            unordered += big[i - 1] > big[i];
+        printf("%zu elements, %zu out of order\n", bigSize, unordered);
+        free(big);
+    }
+
     return 0;
 }
 
-void merge(int* array, int low, int mid, int high)
+int* allocScratch(size_t n)
 {
-    int aux[high - low + 1], i = low, j = mid + 1, k = 0;
+    size_t bytes = n * sizeof(int);
+
+    if (bytes < MSORT_MMAP_THRESHOLD)
+        return (int* )malloc(bytes);
+
+    void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+
+#ifdef MADV_HUGEPAGE
+    madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+
+    return (int* )p;
+}
+
+void freeScratch(int* aux, size_t n)
+{
+    size_t bytes = n * sizeof(int);
+
+    if (bytes < MSORT_MMAP_THRESHOLD)
+        free(aux);
+    else
+        munmap(aux, bytes);
+}
+
+void merge(int* array, int* aux, size_t low, size_t mid, size_t high)
+{
+    // the runs are already in order
+    if (array[mid] <= array[mid + 1])
+        return;
+
+    size_t i = low, j = mid + 1, k = low, n;
+    size_t winsA = 0, winsB = 0;
 
     while (i <= mid && j <= high)
     {
-        if (array[i] < array[j])
-            aux[k++] = array[i++];
-        else if (array[i] > array[j])
-            aux[k++] = array[j++];
-        else
+        int a = array[i], b = array[j];
+        size_t takeB = b < a;   // ties are taken from the left run
+
+        aux[k++] = takeB ? b : a;
+        i += 1 - takeB;
+        j += takeB;
+
+        // consecutive wins of each run, one of them is always 0
+        winsA = (winsA + 1) & (takeB - 1);
+        winsB = (winsB + 1) & (0 - takeB);
+
+        if ((winsA | winsB) >= MSORT_MIN_GALLOP)
         {
-            aux[k++] = array[i++];
-            aux[k++] = array[j++];
+            if (winsA && j <= high)
+            {
+                n = gallopRight(array[j], array + i, mid + 1 - i);
+                memcpy(aux + k, array + i, n * sizeof(int));
+                i += n;
+            }
+            else if (winsB && i <= mid)
+            {
+                n = gallopLeft(array[i], array + j, high + 1 - j);
+                memcpy(aux + k, array + j, n * sizeof(int));
+                j += n;
+            }
+            else
+                n = 0;
+
+            k += n;
+            winsA = winsB = 0;
         }
     }
 
-    while (i <= mid)
-        aux[k++] = array[i++];
+    // what is left of the right run is already in place, what is
+    // left of the left run goes to the end
+    if (i <= mid)
+        memmove(array + k, array + i, (mid + 1 - i) * sizeof(int));
+
+    memcpy(array + low, aux + low, (k - low) * sizeof(int));
+}
+
+size_t gallopRight(int key, const int* a, size_t n)
+{
+    size_t bound = 1;
 
-    while (j <= high)
-        aux[k++] = array[j++];
+    // a[0, bound / 2) are all <= key
+    while (bound <= n && a[bound - 1] <= key)
+        bound *= 2;
 
-    k = 0;
-    i = low;
-    
-    while (i <= high)
-        array[i++] = aux[k++];
+    size_t lo = bound / 2, hi = bound < n ? bound : n;
+    while (lo < hi)
+    {
+        size_t m = lo + (hi - lo) / 2;
+        if (a[m] <= key)
+            lo = m + 1;
+        else
+            hi = m;
+    }
+
+    return lo;
+}
+
+size_t gallopLeft(int key, const int* a, size_t n)
+{
+    size_t bound = 1;
+
+    // a[0, bound / 2) are all < key
+    while (bound <= n && a[bound - 1] < key)
+        bound *= 2;
+
+    size_t lo = bound / 2, hi = bound < n ? bound : n;
+    while (lo < hi)
+    {
+        size_t m = lo + (hi - lo) / 2;
+        if (a[m] < key)
+            lo = m + 1;
+        else
+            hi = m;
+    }
+
+    return lo;
 }
 
-void msort(int* array, int low, int high)
+void msort(int* array, int* aux, size_t low, size_t high)
 {
     if (low < high)
     {
-        int mid = (low + high) / 2;
+        size_t mid = low + (high - low) / 2;
 
-        msort(array, low, mid);
-        msort(array, mid + 1, high);
-        merge(array, low, mid, high);
+        msort(array, aux, low, mid);
+        msort(array, aux, mid + 1, high);
+        merge(array, aux, low, mid, high);
     }
 
     return;
 }
 
-void mergeSort(int* array, int low, int high)
+void mergeSort(int* array, size_t low, size_t high)
 {
-    msort(array, low, high);
+    if (low >= high)
+        return;
+
+    size_t n = high - low + 1;
+    int* aux = allocScratch(n);
+    if (!aux)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return;
+    }
+
+    // aux[i] is the scratch slot of array[low + i]
+    msort(array + low, aux, 0, n - 1);
+    freeScratch(aux, n);
 }
 
-void printIntArray(int* array, int low, int high)
+void printIntArray(int* array, size_t low, size_t high)
 {
-    for (int i = low; i <= high; i++)
+    for (size_t i = low; i <= high; i++)
         printf("%d ", array[i]);
     printf("\n");
 }
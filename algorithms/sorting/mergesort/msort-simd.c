@@ -0,0 +1,563 @@
+/*
+ *  Vectorized merge sort for int and float arrays
+ *  ==============================================
+ *
+ *  Blocks of the array are first sorted in registers with a
+ *  sorting network applied column-wise, followed by a transpose,
+ *  which yields short sorted runs. The runs are then merged
+ *  bottom-up, with a bitonic merge network doing the comparisons
+ *  a whole register at a time.
+ *
+ *  The instruction set is picked once at runtime :-
+ *   => AVX2   : 8 lanes, blocks of 64 sorted into runs of 8
+ *   => SSE4.1 : 4 lanes, blocks of 16 sorted into runs of 4
+ *   => scalar : plain insertion sort and merge
+ *
+ *  Floats are sorted by mapping their bit patterns to ints whose
+ *  signed order matches the IEEE-754 order (negative numbers get
+ *  all bits but the sign flipped) in a separate int buffer, sorting
+ *  those, and mapping them back. As a consequence -0.0 is ordered before +0.0, and NaNs
+ *  end up at either end depending on their sign.
+ *
+ *  Requires GCC or Clang on x86 (target attributes and
+ *  __builtin_cpu_supports()).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // for memcpy()
+#include <stdint.h>
+#include <time.h>
+#include <immintrin.h>
+
+/*
+ *  Declarations
+ */
+
+// sort a whole block of blockLen elements into runs of runLen
+typedef void (*block_fun)(int* block);
+
+// merge the sorted runs a[0..na) and b[0..nb) into out
+typedef void (*merge_fun)(const int* a, size_t na, const int* b, size_t nb, int* out);
+
+/* A set of kernels for one instruction set */
+typedef struct SimdKernel
+{
+    const char* name;
+    size_t      blockLen;  // elements sorted by one sortBlock() call
+    size_t      runLen;    // length of the sorted runs it produces
+    block_fun   sortBlock;
+    merge_fun   mergeRuns;
+} SimdKernel;
+
+// to be called by the user; return 0 on success, -1 on memory
+// error, leaving the array unchanged
+int mergeSortInt(int* array, size_t low, size_t high);
+int mergeSortFloat(float* array, size_t low, size_t high);
+
+// name of the instruction set picked at runtime
+const char* simdLevel(void);
+
+// kernel selection, done once on first use
+const SimdKernel* simdKernel(void);
+
+// sort n ints using the given kernels and scratch space of n ints
+void simdSort(const SimdKernel* kern, int* array, size_t n, int* aux);
+
+// map floats to ints with the same order, and back
+void floatToKey(const float* array, int* keys, size_t n);
+void keyToFloat(const int* keys, float* array, size_t n);
+
+/* Scalar kernels */
+void isortRun(int* array, size_t n);
+void sortBlockScalar(int* block);
+void mergeRunsScalar(const int* a, size_t na, const int* b, size_t nb, int* out);
+
+// merge the tail of a vectorized merge: the 8 pending elements
+// in p[0..np) and what is left of both runs
+void mergeTail(const int* p, size_t np, const int* a, size_t na,
+               const int* b, size_t nb, int* out);
+
+/* SSE4.1 kernels */
+void sortBlockSse(int* block);
+void mergeRunsSse(const int* a, size_t na, const int* b, size_t nb, int* out);
+
+/* AVX2 kernels */
+void sortBlockAvx2(int* block);
+void mergeRunsAvx2(const int* a, size_t na, const int* b, size_t nb, int* out);
+
+/* Helpers */
+void printIntArray(int* array, size_t low, size_t high);
+void printFloatArray(float* array, size_t low, size_t high);
+double elapsed(struct timespec start);
+
+const SimdKernel scalarKernel = { "scalar", 8,  8, sortBlockScalar, mergeRunsScalar };
+const SimdKernel sseKernel    = { "sse4.1", 16, 4, sortBlockSse,    mergeRunsSse    };
+const SimdKernel avx2Kernel   = { "avx2",   64, 8, sortBlockAvx2,   mergeRunsAvx2   };
+
+int main()
+{
+    int size = 10;
+    int iarr[] = { 90, 80, 10, 20, 50, 40, 60, 30, 70, 100 };
+    float farr[] = { 9.0, -8.0, 1.0, 2.0, -5.0, 4.0, 6.0, 3.0, 7.0, 10.0 };
+
+    printf("Test : Vectorized mergesort (%s) :-\n\n", simdLevel());
+    printf("With integer array:-\n");
+    printIntArray(iarr, 0, size - 1);
+    mergeSortInt(iarr, 0, size - 1);
+    printIntArray(iarr, 0, size - 1);
+
+    printf("\nWith floating point array:-\n");
+    printFloatArray(farr, 0, size - 1);
+    mergeSortFloat(farr, 0, size - 1);
+    printFloatArray(farr, 0, size - 1);
+
+    // compare every available kernel on a larger array
+    size_t n = 1 << 22, i;
+    int* input = (int* )malloc(n * sizeof(int));
+    int* array = (int* )malloc(n * sizeof(int));
+    int* aux = (int* )malloc(n * sizeof(int));
+
+    srand(1);
+    for (i = 0; i < n; i++)
+        input[i] = rand() - RAND_MAX / 2;
+
+    printf("\nWith %zu random integers:-\n", n);
+
+    const SimdKernel* kernels[] = { &scalarKernel, &sseKernel, &avx2Kernel };
+    int supported[] = { 1, __builtin_cpu_supports("sse4.1"), __builtin_cpu_supports("avx2") };
+
+    for (int k = 0; k < 3; k++)
+    {
+        if (!supported[k])
+            continue;
+
+        memcpy(array, input, n * sizeof(int));
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        simdSort(kernels[k], array, n, aux);
+        double secs = elapsed(start);
+
+        size_t unordered = 0;
+        for (i = 1; i < n; i++)
+            unordered += array[i - 1] > array[i];
+
+        printf("%-7s : %8.2f ms, %zu out of order\n", kernels[k]->name, secs * 1e3, unordered);
+    }
+
+    free(input);
+    free(array);
+    free(aux);
+
+    return 0;
+}
+
+/*
+ *  Definitions
+ */
+
+const SimdKernel* simdKernel(void)
+{
+    static const SimdKernel* kern = NULL;
+
+    if (!kern)
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            kern = &avx2Kernel;
+        else if (__builtin_cpu_supports("sse4.1"))
+            kern = &sseKernel;
+        else
+            kern = &scalarKernel;
+    }
+
+    return kern;
+}
+
+const char* simdLevel(void)
+{
+    return simdKernel()->name;
+}
+
+void simdSort(const SimdKernel* kern, int* array, size_t n, int* aux)
+{
+    size_t i, width;
+    size_t full = n - n % kern->blockLen;
+
+    // Step 1 : sort whole blocks in registers, then the
+    // remaining tail run by run, so that every run boundary
+    // is a multiple of runLen
+    for (i = 0; i < full; i += kern->blockLen)
+        kern->sortBlock(array + i);
+
+    for (i = full; i < n; i += kern->runLen)
+        isortRun(array + i, n - i < kern->runLen ? n - i : kern->runLen);
+
+    // Step 2 : bottom-up merge passes between array and aux
+    int* src = array;
+    int* dst = aux;
+
+    for (width = kern->runLen; width < n; width *= 2)
+    {
+        for (i = 0; i < n; i += 2 * width)
+        {
+            size_t mid = i + width < n ? i + width : n;
+            size_t end = mid + width < n ? mid + width : n;
+            kern->mergeRuns(src + i, mid - i, src + mid, end - mid, dst + i);
+        }
+
+        int* t = src; src = dst; dst = t;
+    }
+
+    if (src != array)
+        memcpy(array, src, n * sizeof(int));
+}
+
+int mergeSortInt(int* array, size_t low, size_t high)
+{
+    if (low >= high)
+        return 0;
+
+    size_t n = high - low + 1;
+    int* aux = (int* )malloc(n * sizeof(int));
+    if (!aux)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+
+    simdSort(simdKernel(), array + low, n, aux);
+    free(aux);
+    return 0;
+}
+
+void floatToKey(const float* array, int* keys, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        int32_t k;
+        memcpy(&k, array + i, sizeof(k));
+        keys[i] = k ^ ((k >> 31) & 0x7FFFFFFF);
+    }
+}
+
+void keyToFloat(const int* keys, float* array, size_t n)
+{
+    // the mapping only depends on the sign bit, which it
+    // leaves unchanged, so it is its own inverse
+    for (size_t i = 0; i < n; i++)
+    {
+        int32_t k = keys[i] ^ ((keys[i] >> 31) & 0x7FFFFFFF);
+        memcpy(array + i, &k, sizeof(k));
+    }
+}
+
+int mergeSortFloat(float* array, size_t low, size_t high)
+{
+    if (low >= high)
+        return 0;
+
+    // the keys, then the scratch space of simdSort()
+    size_t n = high - low + 1;
+    int* keys = (int* )malloc(2 * n * sizeof(int));
+    if (!keys)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+
+    floatToKey(array + low, keys, n);
+    simdSort(simdKernel(), keys, n, keys + n);
+    keyToFloat(keys, array + low, n);
+    free(keys);
+    return 0;
+}
+
+/* Scalar kernels */
+
+void isortRun(int* array, size_t n)
+{
+    for (size_t j = 1; j < n; j++)
+    {
+        int key = array[j];
+        size_t i = j;
+
+        while (i > 0 && array[i - 1] > key)
+        {
+            array[i] = array[i - 1];
+            i--;
+        }
+        array[i] = key;
+    }
+}
+
+void sortBlockScalar(int* block)
+{
+    isortRun(block, scalarKernel.blockLen);
+}
+
+void mergeRunsScalar(const int* a, size_t na, const int* b, size_t nb, int* out)
+{
+    size_t i = 0, j = 0, k = 0;
+
+    while (i < na && j < nb)
+        out[k++] = b[j] < a[i] ? b[j++] : a[i++];
+
+    while (i < na)
+        out[k++] = a[i++];
+
+    while (j < nb)
+        out[k++] = b[j++];
+}
+
+void mergeTail(const int* p, size_t np, const int* a, size_t na,
+               const int* b, size_t nb, int* out)
+{
+    size_t h = 0, i = 0, j = 0, k = 0;
+
+    while (h < np)
+    {
+        if (i < na && a[i] < p[h] && (j >= nb || a[i] <= b[j]))
+            out[k++] = a[i++];
+        else if (j < nb && b[j] < p[h])
+            out[k++] = b[j++];
+        else
+            out[k++] = p[h++];
+    }
+
+    mergeRunsScalar(a + i, na - i, b + j, nb - j, out + k);
+}
+
+/* SSE4.1 kernels */
+
+// sort the bitonic sequence in v
+__attribute__((target("sse4.1")))
+static inline __m128i bitonicCleanSse(__m128i v)
+{
+    __m128i t = _mm_shuffle_epi32(v, 0x4E); // distance 2
+    v = _mm_blend_epi16(_mm_min_epi32(v, t), _mm_max_epi32(v, t), 0xF0);
+
+    t = _mm_shuffle_epi32(v, 0xB1);         // distance 1
+    v = _mm_blend_epi16(_mm_min_epi32(v, t), _mm_max_epi32(v, t), 0xCC);
+
+    return v;
+}
+
+// merge the sorted vectors a and b into the sorted pair lo, hi
+__attribute__((target("sse4.1")))
+static inline void bitonicMergeSse(__m128i a, __m128i b, __m128i* lo, __m128i* hi)
+{
+    b = _mm_shuffle_epi32(b, 0x1B);         // reverse
+    *lo = bitonicCleanSse(_mm_min_epi32(a, b));
+    *hi = bitonicCleanSse(_mm_max_epi32(a, b));
+}
+
+__attribute__((target("sse4.1")))
+void sortBlockSse(int* block)
+{
+    __m128i r[4], t[4], mn;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        r[i] = _mm_loadu_si128((__m128i* )(block + 4 * i));
+
+    // sort the 4 columns with a 4-input sorting network
+#define CSWAP_SSE(x, y) \
+    mn = _mm_min_epi32(r[x], r[y]); r[y] = _mm_max_epi32(r[x], r[y]); r[x] = mn;
+
+    CSWAP_SSE(0, 1) CSWAP_SSE(2, 3)
+    CSWAP_SSE(0, 2) CSWAP_SSE(1, 3)
+    CSWAP_SSE(1, 2)
+
+#undef CSWAP_SSE
+
+    // transpose, so that each register holds a sorted column
+    t[0] = _mm_unpacklo_epi32(r[0], r[1]);
+    t[1] = _mm_unpackhi_epi32(r[0], r[1]);
+    t[2] = _mm_unpacklo_epi32(r[2], r[3]);
+    t[3] = _mm_unpackhi_epi32(r[2], r[3]);
+    r[0] = _mm_unpacklo_epi64(t[0], t[2]);
+    r[1] = _mm_unpackhi_epi64(t[0], t[2]);
+    r[2] = _mm_unpacklo_epi64(t[1], t[3]);
+    r[3] = _mm_unpackhi_epi64(t[1], t[3]);
+
+    for (i = 0; i < 4; i++)
+        _mm_storeu_si128((__m128i* )(block + 4 * i), r[i]);
+}
+
+__attribute__((target("sse4.1")))
+void mergeRunsSse(const int* a, size_t na, const int* b, size_t nb, int* out)
+{
+    if (na < 4 || nb < 4)
+    {
+        mergeRunsScalar(a, na, b, nb, out);
+        return;
+    }
+
+    __m128i lo, hi, next;
+    size_t i = 4, j = 4, k = 4;
+
+    bitonicMergeSse(_mm_loadu_si128((__m128i* )a), _mm_loadu_si128((__m128i* )b), &lo, &hi);
+    _mm_storeu_si128((__m128i* )out, lo);
+
+    // always load from the run with the smaller head, so that
+    // the lower half of each merge is final
+    while (i + 4 <= na && j + 4 <= nb)
+    {
+        if (a[i] <= b[j])
+        {
+            next = _mm_loadu_si128((__m128i* )(a + i));
+            i += 4;
+        }
+        else
+        {
+            next = _mm_loadu_si128((__m128i* )(b + j));
+            j += 4;
+        }
+
+        bitonicMergeSse(next, hi, &lo, &hi);
+        _mm_storeu_si128((__m128i* )(out + k), lo);
+        k += 4;
+    }
+
+    int pending[4];
+    _mm_storeu_si128((__m128i* )pending, hi);
+    mergeTail(pending, 4, a + i, na - i, b + j, nb - j, out + k);
+}
+
+/* AVX2 kernels */
+
+// sort the bitonic sequence in v
+__attribute__((target("avx2")))
+static inline __m256i bitonicCleanAvx2(__m256i v)
+{
+    __m256i t = _mm256_permute2x128_si256(v, v, 0x01); // distance 4
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xF0);
+
+    t = _mm256_shuffle_epi32(v, 0x4E);                 // distance 2
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xCC);
+
+    t = _mm256_shuffle_epi32(v, 0xB1);                 // distance 1
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xAA);
+
+    return v;
+}
+
+// merge the sorted vectors a and b into the sorted pair lo, hi
+__attribute__((target("avx2")))
+static inline void bitonicMergeAvx2(__m256i a, __m256i b, __m256i* lo, __m256i* hi)
+{
+    b = _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    *lo = bitonicCleanAvx2(_mm256_min_epi32(a, b));
+    *hi = bitonicCleanAvx2(_mm256_max_epi32(a, b));
+}
+
+__attribute__((target("avx2")))
+void sortBlockAvx2(int* block)
+{
+    __m256i r[8], t[8], s[8], mn;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        r[i] = _mm256_loadu_si256((__m256i* )(block + 8 * i));
+
+    // sort the 8 columns with a 19 comparator sorting network
+#define CSWAP_AVX2(x, y) \
+    mn = _mm256_min_epi32(r[x], r[y]); r[y] = _mm256_max_epi32(r[x], r[y]); r[x] = mn;
+
+    CSWAP_AVX2(0, 2) CSWAP_AVX2(1, 3) CSWAP_AVX2(4, 6) CSWAP_AVX2(5, 7)
+    CSWAP_AVX2(0, 4) CSWAP_AVX2(1, 5) CSWAP_AVX2(2, 6) CSWAP_AVX2(3, 7)
+    CSWAP_AVX2(0, 1) CSWAP_AVX2(2, 3) CSWAP_AVX2(4, 5) CSWAP_AVX2(6, 7)
+    CSWAP_AVX2(2, 4) CSWAP_AVX2(3, 5)
+    CSWAP_AVX2(1, 4) CSWAP_AVX2(3, 6)
+    CSWAP_AVX2(1, 2) CSWAP_AVX2(3, 4) CSWAP_AVX2(5, 6)
+
+#undef CSWAP_AVX2
+
+    // 8x8 transpose, so that each register holds a sorted column
+    for (i = 0; i < 8; i += 4)
+    {
+        t[i]     = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+        t[i + 2] = _mm256_unpacklo_epi32(r[i + 2], r[i + 3]);
+        t[i + 3] = _mm256_unpackhi_epi32(r[i + 2], r[i + 3]);
+        s[i]     = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        s[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        s[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        s[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        r[i]     = _mm256_permute2x128_si256(s[i], s[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(s[i], s[i + 4], 0x31);
+    }
+
+    for (i = 0; i < 8; i++)
+        _mm256_storeu_si256((__m256i* )(block + 8 * i), r[i]);
+}
+
+__attribute__((target("avx2")))
+void mergeRunsAvx2(const int* a, size_t na, const int* b, size_t nb, int* out)
+{
+    if (na < 8 || nb < 8)
+    {
+        mergeRunsScalar(a, na, b, nb, out);
+        return;
+    }
+
+    __m256i lo, hi, next;
+    size_t i = 8, j = 8, k = 8;
+
+    bitonicMergeAvx2(_mm256_loadu_si256((__m256i* )a), _mm256_loadu_si256((__m256i* )b), &lo, &hi);
+    _mm256_storeu_si256((__m256i* )out, lo);
+
+    // always load from the run with the smaller head, so that
+    // the lower half of each merge is final
+    while (i + 8 <= na && j + 8 <= nb)
+    {
+        if (a[i] <= b[j])
+        {
+            next = _mm256_loadu_si256((__m256i* )(a + i));
+            i += 8;
+        }
+        else
+        {
+            next = _mm256_loadu_si256((__m256i* )(b + j));
+            j += 8;
+        }
+
+        bitonicMergeAvx2(next, hi, &lo, &hi);
+        _mm256_storeu_si256((__m256i* )(out + k), lo);
+        k += 8;
+    }
+
+    int pending[8];
+    _mm256_storeu_si256((__m256i* )pending, hi);
+    mergeTail(pending, 8, a + i, na - i, b + j, nb - j, out + k);
+}
+
+/* Helpers */
+
+void printIntArray(int* array, size_t low, size_t high)
+{
+    for (size_t i = low; i <= high; i++)
+        printf("%d ", array[i]);
+    printf("\n");
+}
+
+void printFloatArray(float* array, size_t low, size_t high)
+{
+    for (size_t i = low; i <= high; i++)
+        printf("%.1f  ", array[i]);
+    printf("\n");
+}
+
+double elapsed(struct timespec start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
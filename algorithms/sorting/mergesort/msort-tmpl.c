@@ -0,0 +1,326 @@
+/*
+ *  Type-specialized merge sort
+ *  ===========================
+ *
+ *  DEFINE_MSORT(type, less) generates a merge sort for arrays of
+ *  `type`, ordered by `less(a, b)` (a function or macro taking two
+ *  elements by value and returning non-zero if a < b). Since the
+ *  element type and the comparison are known at compile time the
+ *  compiler is free to inline and vectorize them, unlike the generic
+ *  mergeSort() in msort-gen.c which goes through a compare_fun
+ *  pointer and moves elements with memcpy().
+ *
+ *  `type` has to be a single identifier, as it is pasted into the
+ *  generated names; use a typedef for things like `unsigned long`.
+ *
+ *  For each instantiation the following are generated :-
+ *
+ *  // to be called by the user; returns 0 on success, -1 on memory
+ *  // error, leaving the array unchanged
+ *  int mergeSort_type(type* array, size_t low, size_t high);
+ *
+ *  // same, using a caller-owned buffer of (high - low + 1) elements
+ *  void mergeSortScratch_type(type* array, size_t low, size_t high,
+ *                             type* scratch);
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // for memcpy()
+#include <time.h>
+
+// length of the runs sorted by insertion sort before merging
+#define MSORT_TMPL_RUN 32
+
+#define DEFINE_MSORT(type, less)                                             \
+                                                                             \
+static inline void msortIsort_##type(type* array, size_t n)                  \
+{                                                                            \
+    for (size_t j = 1; j < n; j++)                                           \
+    {                                                                        \
+        type key = array[j];                                                 \
+        size_t i = j;                                                        \
+                                                                             \
+        while (i > 0 && less(key, array[i - 1]))                             \
+        {                                                                    \
+            array[i] = array[i - 1];                                         \
+            i--;                                                             \
+        }                                                                    \
+        array[i] = key;                                                      \
+    }                                                                        \
+}                                                                            \
+                                                                             \
+static inline void msortMerge_##type(const type* a, size_t na,               \
+                                     const type* b, size_t nb,               \
+                                     type* out)                              \
+{                                                                            \
+    size_t i = 0, j = 0, k = 0;                                              \
+                                                                             \
+    /* ties are taken from the left run to keep the sort stable */           \
+    while (i < na && j < nb)                                                 \
+    {                                                                        \
+        if (less(b[j], a[i]))                                                \
+            out[k++] = b[j++];                                               \
+        else                                                                 \
+            out[k++] = a[i++];                                               \
+    }                                                                        \
+                                                                             \
+    while (i < na)                                                           \
+        out[k++] = a[i++];                                                   \
+                                                                             \
+    while (j < nb)                                                           \
+        out[k++] = b[j++];                                                   \
+}                                                                            \
+                                                                             \
+void mergeSortScratch_##type(type* array, size_t low, size_t high,           \
+                             type* scratch)                                  \
+{                                                                            \
+    if (low >= high)                                                         \
+        return;                                                              \
+                                                                             \
+    size_t n = high - low + 1, start, width;                                 \
+    type* src = array + low;                                                 \
+    type* dst = scratch;                                                     \
+                                                                             \
+    for (start = 0; start < n; start += MSORT_TMPL_RUN)                      \
+        msortIsort_##type(src + start, n - start < MSORT_TMPL_RUN ?          \
+                          n - start : MSORT_TMPL_RUN);                       \
+                                                                             \
+    /* bottom-up merge passes, alternating between the buffers */            \
+    for (width = MSORT_TMPL_RUN; width < n; width *= 2)                      \
+    {                                                                        \
+        for (start = 0; start < n; start += 2 * width)                       \
+        {                                                                    \
+            size_t mid = start + width < n ? start + width : n;              \
+            size_t end = mid + width < n ? mid + width : n;                  \
+            msortMerge_##type(src + start, mid - start,                      \
+                              src + mid, end - mid, dst + start);            \
+        }                                                                    \
+        type* t = src; src = dst; dst = t;                                   \
+    }                                                                        \
+                                                                             \
+    if (src != array + low)                                                  \
+        memcpy(array + low, src, n * sizeof(type));                          \
+}                                                                            \
+                                                                             \
+int mergeSort_##type(type* array, size_t low, size_t high)                   \
+{                                                                            \
+    if (low >= high)                                                         \
+        return 0;                                                            \
+                                                                             \
+    type* scratch = (type* )malloc((high - low + 1) * sizeof(type));         \
+    if (!scratch)                                                            \
+    {                                                                        \
+        fprintf(stderr, "[ERROR] Memory error\n");                           \
+        return -1;                                                           \
+    }                                                                        \
+                                                                             \
+    mergeSortScratch_##type(array, low, high, scratch);                      \
+    free(scratch);                                                           \
+    return 0;                                                                \
+}
+
+/*
+ *  Instantiations
+ */
+
+#define intLess(a, b)   ((a) < (b))
+#define floatLess(a, b) ((a) < (b))
+#define charLess(a, b)  ((a) < (b))
+
+DEFINE_MSORT(int, intLess)
+DEFINE_MSORT(float, floatLess)
+DEFINE_MSORT(char, charLess)
+
+/* A record type, ordered by its key only */
+typedef struct Record
+{
+    int  key;
+    char tag;
+} Record;
+
+static inline int recordLess(Record a, Record b)
+{
+    return a.key < b.key;
+}
+
+DEFINE_MSORT(Record, recordLess)
+
+/* Helpers */
+void printIntArray(int* array, size_t low, size_t high);
+void printFloatArray(float* array, size_t low, size_t high);
+void printCharArray(char* array, size_t low, size_t high);
+void printRecordArray(Record* array, size_t low, size_t high);
+double elapsed(struct timespec start);
+int compareIntQsort(const void* t1, const void* t2);
+
+int main()
+{
+    // Demonstrate the specialized merge sorts
+
+    int size = 10;
+    int iarr[] = { 90, 80, 10, 20, 50, 40, 60, 30, 70, 100 };
+    float farr[] = { 9.0, 8.0, 1.0, 2.0, 5.0, 4.0, 6.0, 3.0, 7.0, 10.0 };
+    char carr[] = { 'x', 'a', 'b', 'f', 'p', 'e', 'o', 'z', 'c', 'd' };
+    Record rarr[] = { { 3, 'a' }, { 1, 'b' }, { 2, 'c' }, { 1, 'd' }, { 3, 'e' },
+                      { 2, 'f' }, { 0, 'g' }, { 1, 'h' }, { 0, 'i' }, { 2, 'j' } };
+
+    printf("Test : Type-specialized mergesort :-\n\n");
+    printf("With integer array:-\n");
+    printIntArray(iarr, 0, size - 1);
+    mergeSort_int(iarr, 0, size - 1);
+    printIntArray(iarr, 0, size - 1);
+
+    printf("\nWith floating point array:-\n");
+    printFloatArray(farr, 0, size - 1);
+    mergeSort_float(farr, 0, size - 1);
+    printFloatArray(farr, 0, size - 1);
+
+    printf("\nWith character array:-\n");
+    printCharArray(carr, 0, size - 1);
+    mergeSort_char(carr, 0, size - 1);
+    printCharArray(carr, 0, size - 1);
+
+    printf("\nWith record array (stable on equal keys):-\n");
+    printRecordArray(rarr, 0, size - 1);
+    mergeSort_Record(rarr, 0, size - 1);
+    printRecordArray(rarr, 0, size - 1);
+
+    // larger inputs, so that the runs get merged
+    size_t n = 4096, i, bad = 0;
+    int* ibig = (int* )malloc(n * sizeof(int));
+    Record* rbig = (Record* )malloc(n * sizeof(Record));
+    size_t seen[64] = { 0 };
+
+    if (!ibig || !rbig)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(ibig);
+        free(rbig);
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    for (i = 0; i < n; i++)
+    {
+        ibig[i] = rand() - RAND_MAX / 2;
+
+        // 64 keys, each record tagged with the no. of
+        // records of its key before it in the input
+        int key;
+        do
+            key = rand() % 64;
+        while (seen[key] == 255);
+        rbig[i] = (Record){ key, (char)seen[key]++ };
+    }
+
+    if (mergeSort_int(ibig, 0, n - 1) || mergeSort_Record(rbig, 0, n - 1))
+    {
+        free(ibig);
+        free(rbig);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 1; i < n; i++)
+        bad += ibig[i - 1] > ibig[i];
+    printf("\nWith %zu random integers:-\n%zu out of order\n", n, bad);
+
+    // stable iff the tags of equal keys still go up
+    for (i = 1, bad = 0; i < n; i++)
+        bad += rbig[i - 1].key > rbig[i].key ||
+               (rbig[i - 1].key == rbig[i].key &&
+                (unsigned char)rbig[i - 1].tag >= (unsigned char)rbig[i].tag);
+    printf("\nWith %zu records on 64 keys:-\n%zu out of order or unstable\n", n, bad);
+
+    free(ibig);
+    free(rbig);
+
+    // timing against qsort() on a million integers
+    n = 1 << 20;
+    int* input = (int* )malloc(n * sizeof(int));
+    int* work = (int* )malloc(n * sizeof(int));
+    if (!input || !work)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(input);
+        free(work);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < n; i++)
+        input[i] = rand() - RAND_MAX / 2;
+
+    struct timespec start;
+    memcpy(work, input, n * sizeof(int));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int err = mergeSort_int(work, 0, n - 1);
+    double tmplMs = elapsed(start);
+
+    if (err)
+    {
+        free(input);
+        free(work);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 1, bad = 0; i < n; i++)
+        bad += work[i - 1] > work[i];
+
+    memcpy(work, input, n * sizeof(int));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    qsort(work, n, sizeof(int), compareIntQsort);
+    double qsortMs = elapsed(start);
+
+    printf("\nWith %zu random integers:-\n", n);
+    printf("mergeSort_int : %.2f ms, %zu out of order\n", tmplMs, bad);
+    printf("qsort         : %.2f ms\n", qsortMs);
+
+    free(input);
+    free(work);
+
+    return 0;
+}
+
+void printIntArray(int* array, size_t low, size_t high)
+{
+    for (size_t i = low; i <= high; i++)
+        printf("%d ", array[i]);
+    printf("\n");
+}
+
+void printFloatArray(float* array, size_t low, size_t high)
+{
+    for (size_t i = low; i <= high; i++)
+        printf("%.1f  ", array[i]);
+    printf("\n");
+}
+
+void printCharArray(char* array, size_t low, size_t high)
+{
+    for (size_t i = low; i <= high; i++)
+        printf("%c ", array[i]);
+    printf("\n");
+}
+
+void printRecordArray(Record* array, size_t low, size_t high)
+{
+    for (size_t i = low; i <= high; i++)
+        printf("%d%c ", array[i].key, array[i].tag);
+    printf("\n");
+}
+
+double elapsed(struct timespec start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+int compareIntQsort(const void* t1, const void* t2)
+{
+    int _t1 = *(const int*)t1;
+    int _t2 = *(const int*)t2;
+
+    return (_t1 > _t2) - (_t1 < _t2);
+}
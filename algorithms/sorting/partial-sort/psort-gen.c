@@ -0,0 +1,478 @@
+/*
+ *  Generic partial sort and selection
+ *  ==================================
+ *
+ *  partialSort() puts the k smallest elements of an array, in
+ *  order, at its front; nthElement() puts a single element where a
+ *  full sort would have put it. Neither sorts the whole array.
+ *
+ *  partialSort() keeps a bounded max-heap of the k smallest elements
+ *  seen so far when k is small compared to n; on random input
+ *  nearly every element is rejected by a single comparison with the
+ *  top of the heap, so this is close to n comparisons. For larger
+ *  k it selects the k-th element first, then heapsorts the front.
+ *
+ *  nthElement() is an introselect: quickselect with a median-of-3
+ *  pivot, falling back to a heap select if the partitions keep
+ *  coming out lopsided, so that it stays O(n log n) at worst and is
+ *  O(n) on average.
+ *
+ *  Neither of them is stable; they use the compare_fun interface of
+ *  the generic mergeSort().
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // for memcpy()
+#include <time.h>
+
+// elements up to this size are swapped through a slot on the stack
+#define PSORT_STACK_SLOT     256
+
+// partialSort() uses the bounded heap for k up to n / PSORT_HEAP_DIVISOR
+#define PSORT_HEAP_DIVISOR   16
+
+// ranges of at most this many elements are finished by insertion sort
+#define PSORT_INSERTION_MAX  16
+
+/*
+ *  Declarations
+ */
+
+typedef signed char (*compare_fun)(void*, void*);
+
+// to be called by the user
+
+// rearrange array[0, n) so that its k smallest elements come first,
+// in sorted order; the order of the others is unspecified
+// returns 0 on success, -1 on memory error
+int partialSort(void* array, size_t n, size_t k, size_t dataSize, compare_fun compare);
+
+// rearrange array[0, n) so that array[nth] is the element a sort
+// would put there, with nothing greater before it and nothing
+// smaller after it
+// returns 0 on success, -1 on memory error
+int nthElement(void* array, size_t n, size_t nth, size_t dataSize, compare_fun compare);
+
+/* Building blocks, all using `slot`, a buffer of dataSize bytes */
+
+// max-heap of array[0, n) according to compare
+void siftDown(void* array, size_t i, size_t n, size_t dataSize, compare_fun compare, void* slot);
+void makeHeap(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot);
+void sortHeap(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot);
+
+// leave the k smallest elements of array[0, n) as a max-heap in array[0, k)
+void heapSelect(void* array, size_t n, size_t k, size_t dataSize, compare_fun compare,
+                void* slot);
+
+void introSelect(void* array, size_t n, size_t nth, size_t depth, size_t dataSize,
+                 compare_fun compare, void* slot);
+
+// partition array[1, n) around array[0], which must be the median of
+// three of its elements; returns the first index of the upper part
+size_t partition(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot);
+
+void insertionSort(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot);
+void swap(void* a, void* b, size_t dataSize, void* slot);
+
+/*
+ *  Compare functions for int, float and char types
+ */
+signed char compareInt(void* t1, void* t2);
+signed char compareFloat(void* t1, void* t2);
+signed char compareChar(void* t1, void* t2);
+
+/* Helpers */
+void printIntArray(void* array, size_t low, size_t high);
+void printFloatArray(void* array, size_t low, size_t high);
+void printCharArray(void* array, size_t low, size_t high);
+double elapsed(struct timespec* start);
+int compareIntQsort(const void* t1, const void* t2);
+
+// partialSort() array[0, n) for k, and check the first k against a
+// full sort of a copy : sorted, the k smallest, and nothing smaller
+// than the k-th left behind; prints the result
+void checkPartial(void* array, size_t n, size_t k, size_t dataSize, compare_fun compare);
+
+int main()
+{
+    // Demonstrate partial sort and selection for various cases
+
+    char carr[] = "qwertyuiopasdfghjklzxcvbnm";
+    int size = sizeof(carr) - 1;
+
+    // large enough that the 4 smallest go through the bounded heap,
+    // and the 7 smallest through introselect, rather than a plain
+    // insertion sort of the whole array
+    size_t isize = 64, fsize = 40, i;
+    int iarr[64];
+    float farr[40];
+
+    srand(1);
+    for (i = 0; i < isize; i++)
+        iarr[i] = rand() % 100;
+    for (i = 0; i < fsize; i++)
+        farr[i] = (rand() % 200) / 2.0f;
+
+    printf("Test : Generic partial sort and selection :-\n\n");
+    printf("With integer array, 4 smallest:-\n");
+    printIntArray(iarr, 0, isize - 1);
+    checkPartial(iarr, isize, 4, sizeof(int), compareInt);
+    printIntArray(iarr, 0, isize - 1);
+
+    printf("\nWith floating point array, 7 smallest:-\n");
+    printFloatArray(farr, 0, fsize - 1);
+    checkPartial(farr, fsize, 7, sizeof(float), compareFloat);
+    printFloatArray(farr, 0, fsize - 1);
+
+    printf("\nWith character array, median:-\n");
+    printCharArray(carr, 0, size - 1);
+    nthElement(carr, size, size / 2, sizeof(char), compareChar);
+    printCharArray(carr, 0, size - 1);
+    printf("median : %c\n", carr[size / 2]);
+
+    printf("\nWith a larger integer array:-\n");
+    size_t bigSize = 1 << 22, ks[] = { 100, 10000, 1 << 20 };
+    int* big = (int* )malloc(bigSize * sizeof(int));
+    int* ref = (int* )malloc(bigSize * sizeof(int));
+    struct timespec start;
+
+    srand(1);
+    for (size_t i = 0; i < bigSize; i++)
+        ref[i] = rand();
+
+    memcpy(big, ref, bigSize * sizeof(int));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    qsort(ref, bigSize, sizeof(int), compareIntQsort);
+    printf("full qsort          : %8.2f ms\n", elapsed(&start));
+
+    for (size_t t = 0; t < sizeof(ks) / sizeof(ks[0]); t++)
+    {
+        int* work = (int* )malloc(bigSize * sizeof(int));
+        memcpy(work, big, bigSize * sizeof(int));
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        partialSort(work, bigSize, ks[t], sizeof(int), compareInt);
+        double ms = elapsed(&start);
+
+        size_t wrong = 0;
+        for (size_t i = 0; i < ks[t]; i++)
+            wrong += work[i] != ref[i];
+        printf("top %-8zu        : %8.2f ms, %zu misplaced\n", ks[t], ms, wrong);
+        free(work);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    nthElement(big, bigSize, bigSize / 2, sizeof(int), compareInt);
+    double ms = elapsed(&start);
+
+    size_t wrong = big[bigSize / 2] != ref[bigSize / 2];
+    for (size_t i = 0; i < bigSize; i++)
+        wrong += i < bigSize / 2 ? big[i] > big[bigSize / 2] : big[i] < big[bigSize / 2];
+    printf("median              : %8.2f ms, %zu misplaced\n", ms, wrong);
+
+    free(big);
+    free(ref);
+
+    return 0;
+}
+
+/*
+ *  Definitions
+ */
+
+int partialSort(void* array, size_t n, size_t k, size_t dataSize, compare_fun compare)
+{
+    if (k > n)
+        k = n;
+    if (k == 0)
+        return 0;
+
+    char stackSlot[PSORT_STACK_SLOT];
+    void* slot = dataSize <= PSORT_STACK_SLOT ? stackSlot : malloc(dataSize);
+    if (!slot)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+
+    if (k <= n / PSORT_HEAP_DIVISOR)
+        heapSelect(array, n, k, dataSize, compare, slot);
+    else
+    {
+        // the k smallest to the front, then into a heap of their own
+        if (k < n)
+            introSelect(array, n, k - 1, 2 * (size_t)(63 - __builtin_clzll(n)), dataSize,
+                        compare, slot);
+        makeHeap(array, k, dataSize, compare, slot);
+    }
+
+    sortHeap(array, k, dataSize, compare, slot);
+
+    if (slot != stackSlot)
+        free(slot);
+    return 0;
+}
+
+int nthElement(void* array, size_t n, size_t nth, size_t dataSize, compare_fun compare)
+{
+    if (nth >= n)
+        return 0;
+
+    char stackSlot[PSORT_STACK_SLOT];
+    void* slot = dataSize <= PSORT_STACK_SLOT ? stackSlot : malloc(dataSize);
+    if (!slot)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+
+    // the depth budget of introsort, 2 * log2(n)
+    introSelect(array, n, nth, 2 * (size_t)(63 - __builtin_clzll(n)), dataSize, compare, slot);
+
+    if (slot != stackSlot)
+        free(slot);
+    return 0;
+}
+
+void siftDown(void* array, size_t i, size_t n, size_t dataSize, compare_fun compare, void* slot)
+{
+    // move array[i] down through a hole instead of swapping at each level
+    memcpy(slot, array + i * dataSize, dataSize);
+
+    size_t child;
+    while ((child = 2 * i + 1) < n)
+    {
+        if (child + 1 < n && compare(array + child * dataSize, array + (child + 1) * dataSize) < 0)
+            child++;
+        if (compare(slot, array + child * dataSize) >= 0)
+            break;
+
+        memcpy(array + i * dataSize, array + child * dataSize, dataSize);
+        i = child;
+    }
+
+    memcpy(array + i * dataSize, slot, dataSize);
+}
+
+void makeHeap(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot)
+{
+    for (size_t i = n / 2; i-- > 0; )
+        siftDown(array, i, n, dataSize, compare, slot);
+}
+
+void sortHeap(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot)
+{
+    while (n > 1)
+    {
+        n--;
+        swap(array, array + n * dataSize, dataSize, slot);
+        siftDown(array, 0, n, dataSize, compare, slot);
+    }
+}
+
+void heapSelect(void* array, size_t n, size_t k, size_t dataSize, compare_fun compare,
+                void* slot)
+{
+    makeHeap(array, k, dataSize, compare, slot);
+
+    // anything smaller than the largest of the k kept so far replaces it
+    for (size_t i = k; i < n; i++)
+    {
+        if (compare(array + i * dataSize, array) < 0)
+        {
+            swap(array, array + i * dataSize, dataSize, slot);
+            siftDown(array, 0, k, dataSize, compare, slot);
+        }
+    }
+}
+
+void introSelect(void* array, size_t n, size_t nth, size_t depth, size_t dataSize,
+                 compare_fun compare, void* slot)
+{
+    while (n > PSORT_INSERTION_MAX)
+    {
+        if (depth-- == 0)
+        {
+            // the heap top is the largest of the nth + 1 smallest
+            heapSelect(array, n, nth + 1, dataSize, compare, slot);
+            swap(array, array + nth * dataSize, dataSize, slot);
+            return;
+        }
+
+        // median of the second, middle and last elements to the front
+        void* a = array + dataSize;
+        void* b = array + (n / 2) * dataSize;
+        void* c = array + (n - 1) * dataSize;
+        void* median;
+
+        if (compare(a, b) < 0)
+            median = compare(b, c) < 0 ? b : compare(a, c) < 0 ? c : a;
+        else
+            median = compare(a, c) < 0 ? a : compare(b, c) < 0 ? c : b;
+        swap(array, median, dataSize, slot);
+
+        size_t cut = partition(array, n, dataSize, compare, slot);
+
+        // carry on in the part that holds nth
+        if (nth < cut)
+            n = cut;
+        else
+        {
+            array += cut * dataSize;
+            n -= cut;
+            nth -= cut;
+        }
+    }
+
+    insertionSort(array, n, dataSize, compare, slot);
+}
+
+size_t partition(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot)
+{
+    // the median of three bounds both scans, so they need no index checks
+    size_t i = 1, j = n;
+
+    while (1)
+    {
+        while (compare(array + i * dataSize, array) < 0)
+            i++;
+        j--;
+        while (compare(array, array + j * dataSize) < 0)
+            j--;
+
+        if (i >= j)
+            return i;
+
+        swap(array + i * dataSize, array + j * dataSize, dataSize, slot);
+        i++;
+    }
+}
+
+void insertionSort(void* array, size_t n, size_t dataSize, compare_fun compare, void* slot)
+{
+    for (size_t j = 1; j < n; j++)
+    {
+        size_t i = j;
+
+        memcpy(slot, array + j * dataSize, dataSize);
+        while (i > 0 && compare(slot, array + (i - 1) * dataSize) < 0)
+        {
+            memcpy(array + i * dataSize, array + (i - 1) * dataSize, dataSize);
+            i--;
+        }
+        memcpy(array + i * dataSize, slot, dataSize);
+    }
+}
+
+void swap(void* a, void* b, size_t dataSize, void* slot)
+{
+    memcpy(slot, a, dataSize);
+    memcpy(a, b, dataSize);
+    memcpy(b, slot, dataSize);
+}
+
+signed char compareInt(void* t1, void* t2)
+{
+    int _t1 = *(int*)t1;
+    int _t2 = *(int*)t2;
+
+    if (_t1 < _t2)
+        return -1;
+    else if (_t1 > _t2)
+        return 1;
+    else
+        return 0;
+}
+
+signed char compareFloat(void* t1, void* t2)
+{
+    float _t1 = *(float*)t1;
+    float _t2 = *(float*)t2;
+
+    if (_t1 < _t2)
+        return -1;
+    else if (_t1 > _t2)
+        return 1;
+    else
+        return 0;
+}
+
+signed char compareChar(void* t1, void* t2)
+{
+    int _t1 = *(char*)t1;
+    int _t2 = *(char*)t2;
+
+    if (_t1 < _t2)
+        return -1;
+    else if (_t1 > _t2)
+        return 1;
+    else
+        return 0;
+}
+
+int compareIntQsort(const void* t1, const void* t2)
+{
+    int _t1 = *(const int*)t1;
+    int _t2 = *(const int*)t2;
+
+    return (_t1 > _t2) - (_t1 < _t2);
+}
+
+void printIntArray(void* array, size_t low, size_t high)
+{
+    for (size_t i = low; i <= high; i++)
+        printf("%d ", ((int*)array)[i]);
+    printf("\n");
+}
+
+void printFloatArray(void* array, size_t low, size_t high)
+{
+    for (size_t i = low; i <= high; i++)
+        printf("%.1f  ", ((float*)array)[i]);
+    printf("\n");
+}
+
+void printCharArray(void* array, size_t low, size_t high)
+{
+    for (size_t i = low; i <= high; i++)
+        printf("%c ", ((char*)array)[i]);
+    printf("\n");
+}
+
+double elapsed(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+void checkPartial(void* array, size_t n, size_t k, size_t dataSize, compare_fun compare)
+{
+    void* sorted = malloc(n * dataSize);
+    if (!sorted)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return;
+    }
+
+    // a partial sort of all n elements is a full sort
+    memcpy(sorted, array, n * dataSize);
+    partialSort(sorted, n, n, dataSize, compare);
+    partialSort(array, n, k, dataSize, compare);
+
+    size_t misplaced = 0, unsortedTail = 0, i;
+    for (i = 0; i < k; i++)
+        misplaced += compare(array + i * dataSize, sorted + i * dataSize) != 0;
+    for (i = k; i < n; i++)
+    {
+        misplaced += compare(array + i * dataSize, sorted + (k - 1) * dataSize) < 0;
+        if (i > k)
+            unsortedTail += compare(array + (i - 1) * dataSize, array + i * dataSize) > 0;
+    }
+
+    printf("first %zu : %zu misplaced; the other %zu : %zu descents, left unsorted\n",
+           k, misplaced, n - k, unsortedTail);
+    free(sorted);
+}
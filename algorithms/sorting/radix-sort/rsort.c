@@ -0,0 +1,317 @@
+/*
+ *  LSD radix sort
+ *  ==============
+ *
+ *  Sorts int, float and char keys without comparisons, one 8-bit
+ *  digit per pass starting from the least significant one.
+ *
+ *  Each key is first mapped to an unsigned integer whose unsigned
+ *  order matches the order of the original key :-
+ *   => int   : flip the sign bit
+ *   => float : flip the sign bit of positive numbers, and every bit
+ *              of negative ones (IEEE-754 sign-magnitude to two's
+ *              complement style ordering); -0.0 comes before +0.0
+ *   => char  : flip the sign bit if char is signed
+ *
+ *  The histograms of all digits are built in a single read of the
+ *  keys, and a pass is skipped altogether when every key has the
+ *  same digit in it (e.g. the upper bytes of small ints).
+ *
+ *  Every pass is stable, so radixSortIntPairs() carries a payload
+ *  of any size along with each key.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // for memcpy()
+#include <stdint.h>
+#include <limits.h>
+
+#define RADIX_BITS    8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES  (32 / RADIX_BITS)
+
+/*
+ *  Declarations
+ */
+
+// to be called by the user; the int & float sorts return 0 on
+// success and -1 on memory error, leaving the array unchanged
+int radixSortInt(int* array, size_t n);
+int radixSortFloat(float* array, size_t n);
+void radixSortChar(char* array, size_t n);
+
+// sort keys[] and move payload[i] (payloadSize bytes each) along
+// with keys[i]; equal keys keep their relative order
+// returns 0 on success, -1 on memory error
+int radixSortIntPairs(int* keys, void* payload, size_t n, size_t payloadSize);
+
+// sort n unsigned 32-bit keys, and optionally a payload with them
+//  => aux, auxPayload - scratch space as large as keys and payload
+// returns 0 on success, -1 on memory error
+int radixSort32(uint32_t* keys, uint32_t* aux, void* payload, void* auxPayload,
+                size_t n, size_t payloadSize);
+
+/* Key transforms */
+
+// int <-> key, its own inverse
+void intKeys(uint32_t* keys, size_t n);
+
+// float -> key, and back; the bits go through memcpy(), as a
+// float can't be read or written through a uint32_t pointer
+void floatKeys(const float* array, uint32_t* keys, size_t n);
+void floatUnkeys(const uint32_t* keys, float* array, size_t n);
+
+/* Helpers */
+void printIntArray(int* array, size_t n);
+void printFloatArray(float* array, size_t n);
+void printCharArray(char* array, size_t n);
+
+int main()
+{
+    int size = 10;
+    int iarr[] = { 90, -80, 10, 20, -50, 40, 60, -30, 70, 100 };
+    float farr[] = { 9.0, -8.0, 1.0, 2.0, -5.0, 4.0, -0.5, 3.0, 7.0, 10.0 };
+    char carr[] = { 'x', 'a', 'b', 'f', 'p', 'e', 'o', 'z', 'c', 'd' };
+    int karr[] = { 3, 1, 2, 1, 3, 2, 0, 1, 0, 2 };
+    char parr[] = { 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j' };
+
+    printf("Test : LSD radix sort :-\n\n");
+    printf("With integer array:-\n");
+    printIntArray(iarr, size);
+    radixSortInt(iarr, size);
+    printIntArray(iarr, size);
+
+    printf("\nWith floating point array:-\n");
+    printFloatArray(farr, size);
+    radixSortFloat(farr, size);
+    printFloatArray(farr, size);
+
+    printf("\nWith character array:-\n");
+    printCharArray(carr, size);
+    radixSortChar(carr, size);
+    printCharArray(carr, size);
+
+    printf("\nWith key + payload pairs (stable):-\n");
+    for (int i = 0; i < size; i++)
+        printf("%d%c ", karr[i], parr[i]);
+    printf("\n");
+    radixSortIntPairs(karr, parr, size, sizeof(char));
+    for (int i = 0; i < size; i++)
+        printf("%d%c ", karr[i], parr[i]);
+    printf("\n");
+
+    printf("\nWith a larger integer array:-\n");
+    size_t bigSize = 1 << 20, unordered = 0;
+    int* big = (int* )malloc(bigSize * sizeof(int));
+    srand(1);
+    for (size_t i = 0; i < bigSize; i++)
+        big[i] = rand() - RAND_MAX / 2;
+    radixSortInt(big, bigSize);
+    for (size_t i = 1; i < bigSize; i++)
+        unordered += big[i - 1] > big[i];
+    printf("%zu elements, %zu out of order\n", bigSize, unordered);
+    free(big);
+
+    return 0;
+}
+
+/*
+ *  Definitions
+ */
+
+int radixSort32(uint32_t* keys, uint32_t* aux, void* payload, void* auxPayload,
+                size_t n, size_t payloadSize)
+{
+    size_t (*count)[RADIX_BUCKETS] = calloc(RADIX_PASSES, sizeof(*count));
+    if (!count)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+
+    size_t i, d, pass;
+
+    // Step 1 : histogram of every digit, in one read of the keys
+    for (i = 0; i < n; i++)
+        for (pass = 0; pass < RADIX_PASSES; pass++)
+            count[pass][(keys[i] >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+
+    uint32_t* src = keys;
+    uint32_t* dst = aux;
+    char* srcPayload = payload;
+    char* dstPayload = auxPayload;
+
+    // Step 2 : one stable counting sort pass per digit
+    for (pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        unsigned shift = pass * RADIX_BITS;
+
+        // all keys share this digit, nothing would move
+        if (count[pass][(src[0] >> shift) & (RADIX_BUCKETS - 1)] == n)
+            continue;
+
+        // turn the counts into starting offsets
+        size_t offset = 0;
+        for (d = 0; d < RADIX_BUCKETS; d++)
+        {
+            size_t c = count[pass][d];
+            count[pass][d] = offset;
+            offset += c;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            size_t to = count[pass][(src[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+            dst[to] = src[i];
+            if (payload)
+                memcpy(dstPayload + to * payloadSize, srcPayload + i * payloadSize, payloadSize);
+        }
+
+        uint32_t* t = src; src = dst; dst = t;
+        char* tp = srcPayload; srcPayload = dstPayload; dstPayload = tp;
+    }
+
+    if (src != keys)
+    {
+        memcpy(keys, src, n * sizeof(uint32_t));
+        if (payload)
+            memcpy(payload, srcPayload, n * payloadSize);
+    }
+
+    free(count);
+    return 0;
+}
+
+void intKeys(uint32_t* keys, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        keys[i] ^= 0x80000000u;
+}
+
+void floatKeys(const float* array, uint32_t* keys, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t k;
+        memcpy(&k, &array[i], sizeof(k));
+        keys[i] = k ^ ((k & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u);
+    }
+}
+
+void floatUnkeys(const uint32_t* keys, float* array, size_t n)
+{
+    // keys with the sign bit set were positive floats
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t k = keys[i] ^ ((keys[i] & 0x80000000u) ? 0x80000000u : 0xFFFFFFFFu);
+        memcpy(&array[i], &k, sizeof(k));
+    }
+}
+
+int radixSortInt(int* array, size_t n)
+{
+    if (n < 2)
+        return 0;
+
+    // int and uint32_t may alias, so the keys are the array itself
+    uint32_t* keys = (uint32_t* )array;
+    uint32_t* aux = (uint32_t* )malloc(n * sizeof(uint32_t));
+    if (!aux)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+
+    intKeys(keys, n);
+    int err = radixSort32(keys, aux, NULL, NULL, n, 0);
+    intKeys(keys, n);
+
+    free(aux);
+    return err;
+}
+
+int radixSortFloat(float* array, size_t n)
+{
+    if (n < 2)
+        return 0;
+
+    // float and uint32_t may not alias, so the keys get a buffer
+    // of their own, followed by the scratch space
+    uint32_t* keys = (uint32_t* )malloc(2 * n * sizeof(uint32_t));
+    if (!keys)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        return -1;
+    }
+
+    floatKeys(array, keys, n);
+    int err = radixSort32(keys, keys + n, NULL, NULL, n, 0);
+    if (!err)
+        floatUnkeys(keys, array, n);
+
+    free(keys);
+    return err;
+}
+
+void radixSortChar(char* array, size_t n)
+{
+    // a single digit, so this is a plain counting sort
+    size_t count[UCHAR_MAX + 1] = { 0 };
+    unsigned char flip = CHAR_MIN < 0 ? 0x80 : 0;
+    size_t i, d, k = 0;
+
+    for (i = 0; i < n; i++)
+        count[(unsigned char)array[i] ^ flip]++;
+
+    for (d = 0; d <= UCHAR_MAX; d++)
+        while (count[d]--)
+            array[k++] = (char)(d ^ flip);
+}
+
+int radixSortIntPairs(int* keys, void* payload, size_t n, size_t payloadSize)
+{
+    if (n < 2)
+        return 0;
+
+    uint32_t* k = (uint32_t* )keys;
+    uint32_t* aux = (uint32_t* )malloc(n * sizeof(uint32_t));
+    void* auxPayload = malloc(n * payloadSize);
+    if (!aux || !auxPayload)
+    {
+        fprintf(stderr, "[ERROR] Memory error\n");
+        free(aux);
+        free(auxPayload);
+        return -1;
+    }
+
+    intKeys(k, n);
+    int err = radixSort32(k, aux, payload, auxPayload, n, payloadSize);
+    intKeys(k, n);
+
+    free(aux);
+    free(auxPayload);
+    return err;
+}
+
+void printIntArray(int* array, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        printf("%d ", array[i]);
+    printf("\n");
+}
+
+void printFloatArray(float* array, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        printf("%.1f  ", array[i]);
+    printf("\n");
+}
+
+void printCharArray(char* array, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        printf("%c ", array[i]);
+    printf("\n");
+}